@@ -3,6 +3,8 @@ import random
 import subprocess
 import time
 import csv
+import shutil
+import os
 import numpy as np
 import matplotlib.pyplot as plt
 from collections import Counter
@@ -38,6 +40,23 @@ def run_sort(binary, arr, mode):
         raise RuntimeError(p.stderr)
     return dt
 
+def parse_sort_time(stdout):
+    """sort_time= из вывода драйвера: время одной сортировки без запуска и разбора входа"""
+    stats = dict(kv.split("=") for kv in stdout.split() if "=" in kv)
+    return float(stats["sort_time"])
+
+def run_sort_in_process(binary, arr, mode):
+    """Время одной сортировки, измеренное внутри процесса (без запуска и разбора входного файла)"""
+    fname = "statistics/tmp_input.txt"
+    save_array(arr, fname)
+    p = subprocess.run([binary, fname, mode],
+                       stdout=subprocess.PIPE,
+                       stderr=subprocess.PIPE,
+                       text=True)
+    if p.returncode != 0:
+        raise RuntimeError(p.stderr)
+    return parse_sort_time(p.stdout)
+
 def benchmark(binary,
               sizes,
               target_densities,
@@ -194,6 +213,175 @@ def plot_3d_by_target(csv_name, out_png_prefix="statistics/logsort_vs_qsort"):
     print(f"✓ Timeline of the lead time relationship: {out_png_prefix}_ratio.png")
     plt.show()
 
+DTLB_EVENTS = ["dTLB-load-misses", "dTLB-store-misses"]
+LLC_EVENTS = ["LLC-load-misses", "LLC-store-misses"]
+CACHE_LINE = 64
+
+def run_sort_perf(binary, arr, mode, events, extra_args=()):
+    """Запуск под perf stat: время сортировки (sort_time= драйвера) и значения счётчиков events
+    (-1, если perf недоступен); счётчики покрывают весь процесс, включая разбор входа"""
+    fname = "statistics/tmp_input.txt"
+    save_array(arr, fname)
+    cmd = [binary, fname, mode] + [str(a) for a in extra_args]
+    perf = shutil.which("perf")
+    if perf:
+        cmd = [perf, "stat", "-x", ",", "-e", ",".join(events)] + cmd
+    p = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, text=True)
+    if p.returncode != 0:
+        raise RuntimeError(p.stderr)
+    dt = parse_sort_time(p.stdout)
+    counters = {e: -1 for e in events}
+    for line in p.stderr.splitlines():
+        fields = line.split(",")
+        if len(fields) > 2 and fields[2] in counters and fields[0].isdigit():
+            counters[fields[2]] = int(fields[0])
+    return dt, counters
+
+def benchmark_alloc_policies(binary,
+                             sizes,
+                             policies,
+                             touch_threads,
+                             repeats,
+                             csv_name="statistics/results_alloc.csv"):
+    """Сравнение политик размещения буферов: время сортировки и dTLB-промахи относительно default
+    (разбор входа одинаков для всех политик и сокращается в dtlb_delta)"""
+    with open(csv_name, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["policy", "touch_threads", "size", "time", "dtlb_misses", "time_delta", "dtlb_delta"])
+
+        for n in sizes:
+            arr = generate_array_with_density(n, 0.5)
+            base_time, base_misses = None, None
+            for policy in policies:
+                times, misses = [], []
+                for _ in range(repeats):
+                    try:
+                        t, c = run_sort_perf(binary, arr, "logsort", DTLB_EVENTS, (policy, touch_threads))
+                        m = c["dTLB-load-misses"] + c["dTLB-store-misses"] if min(c.values()) >= 0 else -1
+                        times.append(t)
+                        misses.append(m)
+                    except Exception as e:
+                        print(f"ERROR for policy={policy}, n={n}: {e}")
+                if not times:
+                    continue
+                t, m = min(times), min(misses)
+                if base_time is None:
+                    base_time, base_misses = t, m
+                dtlb_delta = m - base_misses if m >= 0 and base_misses >= 0 else ""
+                w.writerow([policy, touch_threads, n, t, m, t - base_time, dtlb_delta])
+                f.flush()
+
+    print(f"✓ Allocation benchmark finished: {csv_name}")
+
+def benchmark_bandwidth(binary,
+                        sizes,
+                        target_densities,
+                        repeats,
+                        csv_name="statistics/results_bandwidth.csv"):
+    """Трафик памяти на элемент: промахи LLC * размер кэш-линии / n"""
+    with open(csv_name, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["algo", "size", "target_density", "time", "llc_misses", "bytes_per_element"])
+
+        for n in sizes:
+            for target_d in target_densities:
+                arr = generate_array_with_density(n, target_d)
+                for algo in ("logsort", "qsort"):
+                    for _ in range(repeats):
+                        try:
+                            t, c = run_sort_perf(binary, arr, algo, LLC_EVENTS)
+                            misses = sum(c.values()) if min(c.values()) >= 0 else -1
+                            per_elem = misses * CACHE_LINE / n if misses >= 0 else -1
+                            w.writerow([algo, n, target_d, t, misses, per_elem])
+                            f.flush()
+                        except Exception as e:
+                            print(f"ERROR for {algo}, n={n}, target_d={target_d}: {e}")
+
+    print(f"✓ Bandwidth benchmark finished: {csv_name}")
+
+def benchmark_service(binary,
+                      job_sizes,
+                      clients_list,
+                      jobs_per_client,
+                      csv_name="statistics/results_service.csv"):
+    """Замкнутый цикл нагрузки: пропускная способность и p99 задержки, executor vs синхронный logsort"""
+    fname = "statistics/tmp_input.txt"
+    save_array(generate_array_with_density(max(job_sizes) * 4, 0.5), fname)
+
+    with open(csv_name, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["mode", "clients", "job_size", "throughput", "p50", "p99"])
+
+        for job_size in job_sizes:
+            for clients in clients_list:
+                for mode in ("service", "service_sync"):
+                    p = subprocess.run([binary, fname, mode, str(clients), str(jobs_per_client), str(job_size)],
+                                       stdout=subprocess.PIPE,
+                                       stderr=subprocess.PIPE,
+                                       text=True)
+                    if p.returncode != 0:
+                        print(f"ERROR for {mode}, clients={clients}, job_size={job_size}: {p.stderr}")
+                        continue
+                    stats = dict(kv.split("=") for kv in p.stdout.split())
+                    w.writerow([mode, clients, job_size, stats["throughput"], stats["p50"], stats["p99"]])
+                    f.flush()
+
+    print(f"✓ Service benchmark finished: {csv_name}")
+
+def benchmark_element_sizes(binary,
+                            generic_binary,
+                            sizes,
+                            elem_sizes,
+                            repeats,
+                            csv_name="statistics/results_elem_size.csv"):
+    """Ускорение специализированных ядер (4/8/16/32 байта) относительно общего пути memcpy,
+    время только сортировки (sort_time= драйвера)"""
+    with open(csv_name, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["elem_size", "size", "time_generic", "time_specialized", "speedup"])
+
+        for n in sizes:
+            arr = generate_array_with_density(n, 0.5)
+            for elem_size in elem_sizes:
+                mode = f"logsort:{elem_size}"
+                try:
+                    t_generic = min(run_sort_in_process(generic_binary, arr, mode) for _ in range(repeats))
+                    t_special = min(run_sort_in_process(binary, arr, mode) for _ in range(repeats))
+                    w.writerow([elem_size, n, t_generic, t_special, t_generic / t_special])
+                    f.flush()
+                except Exception as e:
+                    print(f"ERROR for elem_size={elem_size}, n={n}: {e}")
+
+    print(f"✓ Element size benchmark finished: {csv_name}")
+
+def benchmark_builds(builds,
+                     sizes,
+                     target_densities,
+                     repeats,
+                     csv_name="statistics/results_builds.csv"):
+    """Сравнение сборок (санитайзеры, release, PGO) на одних и тех же массивах, время только сортировки"""
+    builds = {name: binary for name, binary in builds.items() if os.path.exists(binary)}
+    base = next(iter(builds))
+    with open(csv_name, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["build", "size", "target_density", "time", f"speedup_vs_{base}"])
+
+        for n in sizes:
+            for target_d in target_densities:
+                arr = generate_array_with_density(n, target_d)
+                times = {}
+                for name, binary in builds.items():
+                    try:
+                        times[name] = min(run_sort_in_process(binary, arr, "logsort") for _ in range(repeats))
+                    except Exception as e:
+                        print(f"ERROR for {name}, n={n}, target_d={target_d}: {e}")
+                for name, t in times.items():
+                    speedup = times[base] / t if base in times else -1
+                    w.writerow([name, n, target_d, t, speedup])
+                f.flush()
+
+    print(f"✓ Build comparison finished: {csv_name}")
+
 def generate_array_with_exact_density(n, target_density):
     """Генерирует массив с ТОЧНОЙ целевой плотностью уникальных элементов"""
     exact_unique = max(1, round(n * target_density))
@@ -265,6 +453,27 @@ if __name__ == "__main__":
     
     print("\n=== Create graphs ===")
     plot_3d_by_target("statistics/results_detailed.csv")
+
+    print("\n=== Memory traffic per element ===")
+    benchmark_bandwidth(binary, [1000000, 10000000], [0.01, 0.5, 1.0], repeats)
+
+    print("\n=== Per element size kernels (run `make generic` first) ===")
+    benchmark_element_sizes(binary, "./test_logsort/build/logsort_generic.exe",
+                            [100000, 1000000], [4, 8, 16, 32, 24], repeats)
+
+    print("\n=== Sort service under load (throughput, p99) ===")
+    benchmark_service(binary, [100, 1000, 10000, 1000000], [1, 4, 16, 64], 50)
+
+    print("\n=== Sanitizer vs release vs PGO builds (run `make release pgo` first) ===")
+    benchmark_builds({"sanitize": binary,
+                      "release": "./test_logsort/build/release/logsort.exe",
+                      "pgo": "./test_logsort/build/pgo/logsort.exe"},
+                     [100000, 1000000], [0.01, 0.5, 1.0], repeats)
+
+    print("\n=== Allocation policies (time, dTLB misses) ===")
+    benchmark_alloc_policies(binary, [1000000, 10000000],
+                             ["default", "thp", "hugetlb", "interleave", "interleave+thp"],
+                             touch_threads=os.cpu_count() or 1, repeats=3)
     
     # # Опционально: детальный анализ
     # if input("\nЗапустить детальный анализ? (y/n): ").lower() == 'y':
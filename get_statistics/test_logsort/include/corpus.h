@@ -0,0 +1,55 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+#include <stdio.h>
+#include <stdint.h>
+
+// deterministic benchmark datasets, keyed by (distribution, n, density, elem_size, seed) and cached on disk
+// element layout: int key, then int original index (elem_size >= 8), then zero padding
+
+#define CORPUS_MAGIC "LSCORPUS"
+#define CORPUS_VERSION 1u
+#define CORPUS_PATH_SIZE 512
+
+typedef struct
+{
+    const char *distribution; // random, sorted, reversed, sawtooth, organ, nearly
+    size_t n;
+    double density;           // unique keys / n
+    size_t elem_size;         // 4 or >= 8
+    uint64_t seed;
+} CorpusKey;
+
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t elem_size;
+    uint64_t n;
+    uint64_t seed;
+    double density;
+    char distribution[16];
+} CorpusHeader;
+
+// path of the cached dataset inside dir
+void corpus_path(const CorpusKey *key, const char *dir, char *path, size_t path_size);
+
+// fills n * elem_size bytes, return 0 on success, -1 on unknown distribution or bad elem_size
+int corpus_generate(const CorpusKey *key, void *data);
+
+// loads the dataset from dir, generates and stores it first if it is missing or stale
+// *data is allocated with malloc, return 0 on success, -1 on error
+int corpus_load(const CorpusKey *key, const char *dir, void **data);
+
+// FNV-1a over the bytes, used as the golden checksum of a sorted dataset
+uint64_t corpus_checksum(const void *data, size_t size);
+
+// sorts every dataset of the built-in matrix with logsort (best of repeats runs per dataset)
+// golden_file holds the sorted checksums and is machine-independent, baseline_file holds the throughput
+// and the speedup over qsort (timed interleaved) of this machine; fails if a checksum differs or the
+// geometric mean of current / baseline speedup drops by more than tolerance (0.1 = 10%)
+// a missing file is recorded from this run
+// return 0 on pass, 1 on regression, -1 on error
+int corpus_regress(const char *dir, const char *golden_file, const char *baseline_file, double tolerance, 
+                   size_t repeats);
+
+#endif
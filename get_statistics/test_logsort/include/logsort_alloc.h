@@ -0,0 +1,43 @@
+#ifndef LOGSORT_ALLOC_H
+#define LOGSORT_ALLOC_H
+#include <stdio.h>
+
+#include "logsort_api.h"
+
+LOGSORT_BEGIN_DECLS
+
+// allocation policy flags for sort scratch and driver input arrays
+#define LOGSORT_ALLOC_DEFAULT    0u // calloc
+#define LOGSORT_ALLOC_HUGEPAGE   1u // anonymous mmap + madvise(MADV_HUGEPAGE), transparent huge pages
+#define LOGSORT_ALLOC_HUGETLB    2u // mmap(MAP_HUGETLB) from the reserved pool, falls back to HUGEPAGE
+#define LOGSORT_ALLOC_INTERLEAVE 4u // mbind(MPOL_INTERLEAVE) over the nodes that have memory
+
+// smaller buffers ignore the flags and touch_threads and come from calloc (one huge page)
+#define LOGSORT_ALLOC_MIN_BYTES (2u << 20)
+
+typedef struct
+{
+    void *data;
+    size_t size;   // requested size in bytes
+    size_t mapped; // length of the mapping, 0 if data came from calloc
+} LogsortBuffer;
+
+// zeroed buffer of size bytes
+// touch_threads > 1: pages are first touched by touch_threads threads, thread t pins itself to the t-th
+// allowed CPU before its first write and touches the t-th contiguous slice,
+// so on NUMA machines slice t lands on the node of that CPU
+// (a slice whose thread cannot be started is touched by the calling thread)
+// return 0 on success, -1 on error (also when mbind rejects LOGSORT_ALLOC_INTERLEAVE, errno is kept)
+int logsort_buffer_alloc(LogsortBuffer *buffer, size_t size, unsigned flags, size_t touch_threads);
+void logsort_buffer_free(LogsortBuffer *buffer);
+
+// policy used by logsort() for its scratch buffer, process-wide
+void logsort_set_scratch_policy(unsigned flags, size_t touch_threads);
+void logsort_get_scratch_policy(unsigned *flags, size_t *touch_threads);
+
+// parses "default", "thp", "hugetlb", "interleave" joined by '+', return 0 on success, -1 on error
+int logsort_parse_alloc_policy(const char *name, unsigned *flags);
+
+LOGSORT_END_DECLS
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef LOGSORT_API_H
+#define LOGSORT_API_H
+
+// every public header wraps its declarations in LOGSORT_BEGIN_DECLS / LOGSORT_END_DECLS:
+// C linkage, so liblogsort can be called from C and its symbol names do not depend on the C++ compiler,
+// and default visibility, so with -fvisibility=hidden the shared library exports exactly these functions
+#if defined(__GNUC__)
+#define LOGSORT_VISIBILITY_PUSH _Pragma("GCC visibility push(default)")
+#define LOGSORT_VISIBILITY_POP _Pragma("GCC visibility pop")
+#else
+#define LOGSORT_VISIBILITY_PUSH
+#define LOGSORT_VISIBILITY_POP
+#endif
+
+#ifdef __cplusplus
+#define LOGSORT_BEGIN_DECLS LOGSORT_VISIBILITY_PUSH extern "C" {
+#define LOGSORT_END_DECLS } LOGSORT_VISIBILITY_POP
+#else
+#define LOGSORT_BEGIN_DECLS LOGSORT_VISIBILITY_PUSH
+#define LOGSORT_END_DECLS LOGSORT_VISIBILITY_POP
+#endif
+
+// bumped on every incompatible change of a public signature or struct layout (shared library soname)
+#define LOGSORT_ABI_VERSION 1
+
+#endif
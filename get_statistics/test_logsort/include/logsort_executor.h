@@ -0,0 +1,47 @@
+#ifndef LOGSORT_EXECUTOR_H
+#define LOGSORT_EXECUTOR_H
+#include <stdio.h>
+
+#include "logsort.h"
+#include "logsort_api.h"
+
+LOGSORT_BEGIN_DECLS
+
+#define LOGSORT_EXECUTOR_QUEUE_SIZE 1024
+#define LOGSORT_EXECUTOR_SMALL_BYTES (64 << 10) // jobs below this are claimed in batches by one worker
+#define LOGSORT_EXECUTOR_BATCH 16
+#ifndef LOGSORT_EXECUTOR_SPLIT_BYTES
+#define LOGSORT_EXECUTOR_SPLIT_BYTES (8 << 20)  // jobs above this are split across workers
+#endif
+#ifndef LOGSORT_EXECUTOR_SCRATCH_KEEP
+#define LOGSORT_EXECUTOR_SCRATCH_KEEP (16 << 20) // larger worker scratch is freed after the job
+#endif
+
+// called on a worker thread once array is sorted
+typedef void (*logsort_done_func_t)(void *array, size_t size_of_array, void *user_data);
+
+typedef struct LogsortExecutor LogsortExecutor;
+typedef struct LogsortJob LogsortJob;
+
+// pool of worker_count threads (0 -> all hardware threads), each worker keeps its own scratch buffer
+// return NULL if the memory or the threads cannot be obtained
+LogsortExecutor *logsort_executor_create(size_t worker_count);
+// finishes every submitted job, then stops the workers
+void logsort_executor_destroy(LogsortExecutor *executor);
+
+// queues a sort of array, done may be NULL
+// the returned job must be released by logsort_job_wait() or logsort_job_release()
+// if the queue is full the job runs on the calling thread before submit returns
+// return NULL on error
+LogsortJob *logsort_executor_submit(LogsortExecutor *executor, void *array, size_t size_of_array, 
+                                    size_t size_of_element, cmp_func_t cmp, logsort_done_func_t done, 
+                                    void *user_data);
+
+// blocks until the job is sorted, then releases it
+void logsort_job_wait(LogsortJob *job);
+// releases the handle without waiting, the job still runs
+void logsort_job_release(LogsortJob *job);
+
+LOGSORT_END_DECLS
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef LOGSORT_VERIFY_H
+#define LOGSORT_VERIFY_H
+#include <stdio.h>
+
+#include "logsort.h"
+#include "logsort_api.h"
+
+LOGSORT_BEGIN_DECLS
+
+#define LOGSORT_VERIFY_SAMPLES 1024
+
+// index of the first element that is less than its predecessor, size_of_array if sorted
+// the array is checked in parallel chunks, thread_count == 0 -> all hardware threads
+// a chunk whose thread cannot be started is checked on the calling thread
+size_t logsort_sorted_until(const void *array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                            size_t thread_count);
+
+// like logsort_sorted_until, but also fails where equal neighbours have decreasing original_index
+size_t logsort_stable_until(const void *array, const size_t *original_index, size_t size_of_array, 
+                            size_t size_of_element, cmp_func_t cmp, size_t thread_count);
+
+// checks only `samples` evenly spaced neighbour pairs, return 1 if all of them are in order
+int logsort_sample_sorted(const void *array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                          size_t samples);
+
+// tagging mode: sorts the array carrying a hidden index, original_index[i] is the old position of array[i]
+// return 0 on success, -1 on error
+int logsort_tagged(void *array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                   size_t *original_index);
+
+// prints the failed check and aborts, full == 0 -> sampled check only
+void logsort_check_sorted(const void *array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                          int full, const char *file, int line);
+
+// post-condition: full parallel check in _DEBUG builds, sampled check in release builds
+#ifdef _DEBUG
+#define LOGSORT_CHECK_SORTED(array, size_of_array, size_of_element, cmp) \
+    logsort_check_sorted(array, size_of_array, size_of_element, cmp, 1, __FILE__, __LINE__)
+#else
+#define LOGSORT_CHECK_SORTED(array, size_of_array, size_of_element, cmp) \
+    logsort_check_sorted(array, size_of_array, size_of_element, cmp, 0, __FILE__, __LINE__)
+#endif
+
+LOGSORT_END_DECLS
+
+#endif
@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "corpus.h"
+#include "logsort.h"
+
+#define CORPUS_MAX_ENTRIES 256
+#define CORPUS_LINE_SIZE 512
+#define CORPUS_MIN_SAMPLE_SEC 0.01
+
+typedef struct
+{
+    int key;
+    int original_index;
+} CorpusItem;
+
+static int cmp_corpus_key(const void *pa, const void *pb) 
+{
+    int a = *(const int *)pa;
+    int b = *(const int *)pb;
+    if (a < b) return -1;
+    if (a > b) return +1;
+    return 0;
+}
+
+static uint64_t splitmix64(uint64_t *state) 
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static double now_sec(void) 
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) 
+    {
+        return 0.0;
+    }
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void corpus_path(const CorpusKey *key, const char *dir, char *path, size_t path_size) 
+{
+    snprintf(path, path_size, "%s/%s_n%zu_d%g_e%zu_s%llu.bin", dir, key->distribution, key->n, key->density, 
+             key->elem_size, (unsigned long long)key->seed);
+}
+
+int corpus_generate(const CorpusKey *key, void *data) 
+{
+    if (!key || !data || (key->elem_size != sizeof(int) && key->elem_size < sizeof(CorpusItem))) 
+    {
+        return -1;
+    }
+
+    size_t n = key->n;
+    size_t unique = (size_t)(key->density * (double)n);
+    if (unique == 0) 
+    {
+        unique = 1;
+    }
+
+    int *keys = (int *)calloc(n ? n : 1, sizeof(int));
+    if (!keys) 
+    {
+        return -1;
+    }
+
+    uint64_t state = key->seed;
+    const char *dist = key->distribution;
+    for (size_t i = 0; i < n; i++) 
+    {
+        size_t k = 0;
+        if (strcmp(dist, "random") == 0) 
+        {
+            k = splitmix64(&state) % unique;
+        } 
+        else if (strcmp(dist, "sorted") == 0 || strcmp(dist, "nearly") == 0) 
+        {
+            k = i * unique / n;
+        } 
+        else if (strcmp(dist, "reversed") == 0) 
+        {
+            k = (n - 1 - i) * unique / n;
+        } 
+        else if (strcmp(dist, "sawtooth") == 0) 
+        {
+            k = i % unique;
+        } 
+        else if (strcmp(dist, "organ") == 0) 
+        {
+            size_t half = (n + 1) / 2;
+            k = (i < half ? i : n - 1 - i) * unique / half;
+        } 
+        else 
+        {
+            free(keys);
+            return -1;
+        }
+        keys[i] = (int)k;
+    }
+
+    // nearly sorted: 1% of the positions swapped at random
+    if (strcmp(dist, "nearly") == 0 && n > 1) 
+    {
+        for (size_t s = 0; s < n / 100; s++) 
+        {
+            size_t a = splitmix64(&state) % n;
+            size_t b = splitmix64(&state) % n;
+            int tmp = keys[a];
+            keys[a] = keys[b];
+            keys[b] = tmp;
+        }
+    }
+
+    char *out = (char *)data;
+    memset(out, 0, n * key->elem_size);
+    for (size_t i = 0; i < n; i++) 
+    {
+        CorpusItem item = {keys[i], (int)i};
+        memcpy(out + i * key->elem_size, &item, key->elem_size < sizeof(CorpusItem) ? key->elem_size : sizeof(CorpusItem));
+    }
+
+    free(keys);
+    return 0;
+}
+
+static void fill_header(const CorpusKey *key, CorpusHeader *header) 
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CORPUS_MAGIC, sizeof(header->magic));
+    header->version = CORPUS_VERSION;
+    header->elem_size = (uint32_t)key->elem_size;
+    header->n = key->n;
+    header->seed = key->seed;
+    header->density = key->density;
+    strncpy(header->distribution, key->distribution, sizeof(header->distribution) - 1);
+}
+
+int corpus_load(const CorpusKey *key, const char *dir, void **data) 
+{
+    if (!key || !dir || !data) 
+    {
+        return -1;
+    }
+
+    char path[CORPUS_PATH_SIZE];
+    corpus_path(key, dir, path, sizeof(path));
+
+    CorpusHeader expected;
+    fill_header(key, &expected);
+
+    size_t size = key->n * key->elem_size;
+    char *buffer = (char *)malloc(size ? size : 1);
+    if (!buffer) 
+    {
+        return -1;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (f) 
+    {
+        CorpusHeader header;
+        int ok = fread(&header, sizeof(header), 1, f) == 1 && memcmp(&header, &expected, sizeof(header)) == 0 && 
+                 (size == 0 || fread(buffer, size, 1, f) == 1);
+        fclose(f);
+        if (ok) 
+        {
+            *data = buffer;
+            return 0;
+        }
+    }
+
+    if (corpus_generate(key, buffer) != 0) 
+    {
+        free(buffer);
+        return -1;
+    }
+
+    mkdir(dir, 0755);
+    f = fopen(path, "wb");
+    if (f) 
+    {
+        if (fwrite(&expected, sizeof(expected), 1, f) != 1 || (size > 0 && fwrite(buffer, size, 1, f) != 1)) 
+        {
+            fprintf(stderr, "Cannot write corpus file '%s'\n", path);
+        }
+        fclose(f);
+    } 
+    else 
+    {
+        fprintf(stderr, "Cannot cache corpus file '%s': %s\n", path, strerror(errno));
+    }
+
+    *data = buffer;
+    return 0;
+}
+
+uint64_t corpus_checksum(const void *data, size_t size) 
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++) 
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+typedef struct
+{
+    char name[CORPUS_PATH_SIZE];
+    uint64_t checksum;
+    double throughput; // elements per second
+    double speedup;    // qsort time / logsort time, measured interleaved on the same data
+} CorpusResult;
+
+typedef void (*corpus_sort_t)(void *array, size_t n, size_t elem_size, int (*cmp)(const void *, const void *));
+
+// sorts a fresh copy of data again and again for at least CORPUS_MIN_SAMPLE_SEC, return seconds per sort
+static double sample_sort(corpus_sort_t sort, char *work, const void *data, size_t n, size_t elem_size) 
+{
+    double spent = 0.0;
+    size_t runs = 0;
+    do 
+    {
+        memcpy(work, data, n * elem_size);
+        double t0 = now_sec();
+        sort(work, n, elem_size, cmp_corpus_key);
+        spent += now_sec() - t0;
+        runs++;
+    } while (spent < CORPUS_MIN_SAMPLE_SEC);
+    return spent / (double)runs;
+}
+
+// golden file: "name,checksum" lines, baseline file: "name,throughput,speedup" lines
+static int load_results(const char *file, int with_checksum, CorpusResult *results, size_t *count) 
+{
+    FILE *f = fopen(file, "r");
+    if (!f) 
+    {
+        return -1;
+    }
+
+    char line[CORPUS_LINE_SIZE];
+    *count = 0;
+    while (fgets(line, sizeof(line), f) && *count < CORPUS_MAX_ENTRIES) 
+    {
+        CorpusResult *r = &results[*count];
+        unsigned long long checksum = 0;
+        if (with_checksum ? sscanf(line, "%511[^,],%llx", r->name, &checksum) == 2 : 
+                            sscanf(line, "%511[^,],%lf,%lf", r->name, &r->throughput, &r->speedup) == 3) 
+        {
+            r->checksum = checksum;
+            (*count)++;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static int save_results(const char *file, int with_checksum, const CorpusResult *results, size_t count) 
+{
+    FILE *f = fopen(file, "w");
+    if (!f) 
+    {
+        fprintf(stderr, "Cannot write '%s': %s\n", file, strerror(errno));
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) 
+    {
+        if (with_checksum) 
+        {
+            fprintf(f, "%s,%016llx\n", results[i].name, (unsigned long long)results[i].checksum);
+        } 
+        else 
+        {
+            fprintf(f, "%s,%.3f,%.4f\n", results[i].name, results[i].throughput, results[i].speedup);
+        }
+    }
+    fclose(f);
+    printf("Recorded %s (%zu datasets)\n", file, count);
+    return 0;
+}
+
+static const CorpusResult *find_result(const CorpusResult *results, size_t count, const char *name) 
+{
+    for (size_t i = 0; i < count; i++) 
+    {
+        if (strcmp(results[i].name, name) == 0) 
+        {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+int corpus_regress(const char *dir, const char *golden_file, const char *baseline_file, double tolerance, 
+                   size_t repeats) 
+{
+    static const char *distributions[] = {"random", "sorted", "reversed", "sawtooth", "organ", "nearly"};
+    static const size_t sizes[] = {10000, 300000};
+    static const double densities[] = {0.01, 0.5, 1.0};
+    static const size_t elem_sizes[] = {4, 8, 16, 32};
+    const uint64_t seed = 123;
+
+    CorpusResult *golden = (CorpusResult *)calloc(CORPUS_MAX_ENTRIES, sizeof(CorpusResult));
+    CorpusResult *baseline = (CorpusResult *)calloc(CORPUS_MAX_ENTRIES, sizeof(CorpusResult));
+    CorpusResult *current = (CorpusResult *)calloc(CORPUS_MAX_ENTRIES, sizeof(CorpusResult));
+    if (!golden || !baseline || !current) 
+    {
+        free(golden);
+        free(baseline);
+        free(current);
+        return -1;
+    }
+    size_t golden_cnt = 0;
+    size_t baseline_cnt = 0;
+    int have_golden = load_results(golden_file, 1, golden, &golden_cnt) == 0;
+    int have_baseline = load_results(baseline_file, 0, baseline, &baseline_cnt) == 0;
+    size_t current_cnt = 0;
+    int failed = 0;
+    // geometric mean of current / baseline speedup over the datasets present in both
+    double log_ratio_sum = 0.0;
+    size_t ratio_cnt = 0;
+
+    for (const char *dist : distributions) 
+    {
+        for (size_t n : sizes) 
+        {
+            for (double density : densities) 
+            {
+                for (size_t elem_size : elem_sizes) 
+                {
+                    CorpusKey key = {dist, n, density, elem_size, seed};
+                    void *data = NULL;
+                    char *work = NULL;
+                    if (corpus_load(&key, dir, &data) != 0 || !(work = (char *)malloc(n * elem_size))) 
+                    {
+                        fprintf(stderr, "Cannot build dataset %s n=%zu\n", dist, n);
+                        free(data);
+                        free(golden);
+                        free(baseline);
+                        free(current);
+                        return -1;
+                    }
+                    // logsort and qsort samples alternate, so a machine that slows down hits both alike;
+                    // the best sample of repeats counts for each
+                    double best = 0.0;
+                    double best_ref = 0.0;
+                    for (size_t r = 0; r < (repeats ? repeats : 1); r++) 
+                    {
+                        double ref = sample_sort(qsort, work, data, n, elem_size);
+                        double dt = sample_sort(logsort, work, data, n, elem_size);
+                        best_ref = r == 0 || ref < best_ref ? ref : best_ref;
+                        best = r == 0 || dt < best ? dt : best;
+                    }
+
+                    CorpusResult *res = &current[current_cnt++];
+                    snprintf(res->name, sizeof(res->name), "%s_n%zu_d%g_e%zu_s%llu", dist, n, density, elem_size, 
+                             (unsigned long long)seed);
+                    res->checksum = corpus_checksum(work, n * elem_size);
+                    res->throughput = best > 0.0 ? (double)n / best : 0.0;
+                    res->speedup = best > 0.0 ? best_ref / best : 0.0;
+                    free(work);
+                    free(data);
+
+                    const CorpusResult *g = find_result(golden, golden_cnt, res->name);
+                    const CorpusResult *b = find_result(baseline, baseline_cnt, res->name);
+                    if (have_golden && (!g || g->checksum != res->checksum)) 
+                    {
+                        printf("FAIL %s: checksum %016llx, golden %016llx\n", res->name, 
+                               (unsigned long long)res->checksum, g ? (unsigned long long)g->checksum : 0ull);
+                        failed = 1;
+                    } 
+                    else if (b && b->speedup > 0.0 && res->speedup > 0.0) 
+                    {
+                        log_ratio_sum += log(res->speedup / b->speedup);
+                        ratio_cnt++;
+                        printf("ok   %s: %.0f elem/s, %.2fx qsort (%+.1f%%)\n", res->name, res->throughput, 
+                               res->speedup, 100.0 * (res->speedup / b->speedup - 1.0));
+                    } 
+                    else 
+                    {
+                        printf("ok   %s: %.0f elem/s, %.2fx qsort\n", res->name, res->throughput, res->speedup);
+                    }
+                }
+            }
+        }
+    }
+
+    // single datasets are too noisy to gate on, only the geometric mean over the matrix is compared;
+    // speedup over qsort instead of raw throughput cancels out changes of the machine speed
+    if (ratio_cnt > 0) 
+    {
+        double geomean = exp(log_ratio_sum / (double)ratio_cnt);
+        int slower = geomean < 1.0 - tolerance;
+        printf("%s geomean speedup over qsort on %zu datasets: %+.1f%% vs baseline (tolerance %.1f%%)\n", 
+               slower ? "FAIL" : "ok  ", ratio_cnt, 100.0 * (geomean - 1.0), 100.0 * tolerance);
+        failed |= slower;
+    }
+
+    int res = failed;
+    if ((!have_golden && save_results(golden_file, 1, current, current_cnt) != 0) || 
+        (!have_baseline && save_results(baseline_file, 0, current, current_cnt) != 0)) 
+    {
+        res = -1;
+    }
+
+    free(golden);
+    free(baseline);
+    free(current);
+    return res;
+}
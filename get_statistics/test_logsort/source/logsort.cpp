@@ -1,138 +1,345 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "logsort.h"
+#include "logsort_alloc.h"
+#ifdef LOGSORT_POSTCONDITION
+#include "logsort_verify.h"
+#endif
 
 #define THRESHOLD_INSERTION 32
 #define MERGE_BUFFER_SIZE 256
 
-static void optimized_insertion_sort(char* array, size_t n, size_t elem_size, cmp_func_t cmp) 
+// element move policies: every kernel below is instantiated once per policy
+// FixedElement<N> has a compile-time size, so copies become typed loads/stores and index math folds
+// GenericElement is the fallback for any other size_of_element
+template <size_t N>
+struct FixedElement 
+{
+    static constexpr size_t size = N;
+    
+    void copy(char* dst, const char* src) const 
+    {
+        memcpy(dst, src, N);
+    }
+};
+
+struct GenericElement 
+{
+    size_t size;
+    
+    void copy(char* dst, const char* src) const 
+    {
+        memcpy(dst, src, size);
+    }
+};
+
+// calls body(elem) with the policy for elem_size, build with -DLOGSORT_GENERIC_ONLY to disable specialization
+template <typename Body>
+static void dispatch_element_size(size_t elem_size, Body&& body) 
+{
+#ifndef LOGSORT_GENERIC_ONLY
+    switch (elem_size) 
+    {
+        case 4:
+            body(FixedElement<4>());
+            return;
+        case 8:
+            body(FixedElement<8>());
+            return;
+        case 16:
+            body(FixedElement<16>());
+            return;
+        case 32:
+            body(FixedElement<32>());
+            return;
+        default:
+            break;
+    }
+#endif
+    body(GenericElement{elem_size});
+}
+
+template <typename Element>
+static void insertion_sort(Element elem, char* array, size_t n, cmp_func_t cmp) 
 {
     if (n <= 1) 
     {
         return;
     }
     
-    if (elem_size <= MERGE_BUFFER_SIZE) 
+    const size_t elem_size = elem.size;
+    alignas(16) char stack_temp[MERGE_BUFFER_SIZE];
+    char* temp = stack_temp;
+    if (elem_size > MERGE_BUFFER_SIZE) 
     {
-        char temp[MERGE_BUFFER_SIZE];
-        for (size_t i = 1; i < n; i++) 
+        temp = (char*)calloc(elem_size, sizeof(char));
+        if (!temp) 
         {
-            char* current = array + i * elem_size;
-            memcpy(temp, current, elem_size);
-            
-            size_t j = i;
-            while (j > 0 && cmp(array + (j-1) * elem_size, temp) > 0) 
-            {
-                memcpy(array + j * elem_size, array + (j-1) * elem_size, elem_size);
-                j--;
-            }
-            
-            if (j != i) 
-            {
-                memcpy(array + j * elem_size, temp, elem_size);
-            }
+            return;
         }
-    } 
-    else 
+    }
+    
+    char* end = array + n * elem_size;
+    for (char* current = array + elem_size; current != end; current += elem_size) 
     {
-        char* temp = (char*)calloc(elem_size, sizeof(char));
-        if (!temp) 
+        elem.copy(temp, current);
+        
+        char* pos = current;
+        while (pos != array && cmp(pos - elem_size, temp) > 0) 
         {
-            return;
+            elem.copy(pos, pos - elem_size);
+            pos -= elem_size;
         }
         
-        for (size_t i = 1; i < n; i++) 
+        if (pos != current) 
         {
-            char* current = array + i * elem_size;
-            memcpy(temp, current, elem_size);
-            
-            size_t j = i;
-            while (j > 0 && cmp(array + (j-1) * elem_size, temp) > 0) 
-            {
-                memcpy(array + j * elem_size, array + (j-1) * elem_size, elem_size);
-                j--;
-            }
-            
-            if (j != i) 
-            {
-                memcpy(array + j * elem_size, temp, elem_size);
-            }
+            elem.copy(pos, temp);
         }
+    }
+    
+    if (temp != stack_temp) 
+    {
         free(temp);
     }
 }
 
+static void optimized_insertion_sort(char* array, size_t n, size_t elem_size, cmp_func_t cmp) 
+{
+    dispatch_element_size(elem_size, [&](auto elem) 
+    {
+        insertion_sort(elem, array, n, cmp);
+    });
+}
+
 void intersection_sort(char* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp) 
 {
     optimized_insertion_sort(array, size_of_array, size_of_element, cmp);
 }
 
-size_t stable_partition(void* array, size_t n, size_t elem_size, 
-                       void* pivot, cmp_func_t cmp, void* buffer) 
+// duplicate elimination fused into the sort (logsort_unique / logsort_reduce)
+// every run of equal elements keeps its first element, later ones are folded into it by combine (if set)
+// and their slots are marked in dead[], which is indexed from base; a final pass squeezes dead slots out
+typedef struct 
 {
-    char* src = (char*)array;
-    char* dst = (char*)buffer;
+    combine_func_t combine;
+    unsigned char* dead;
+    char* base;
+    size_t elem_size;
+} Collapse;
+
+static void mark_dead(const Collapse* collapse, char* first, size_t count)
+{
+    if (count > 0 && collapse->dead) 
+    {
+        memset(collapse->dead + (size_t)(first - collapse->base) / collapse->elem_size, 1, count);
+    }
+}
+
+// sorted range: equal neighbours are folded into the first one and the freed tail is marked dead
+// return count of kept elements
+template <typename Element>
+static size_t collapse_sorted(Element elem, char* array, size_t n, cmp_func_t cmp, const Collapse* collapse)
+{
+    if (n <= 1) 
+    {
+        return n;
+    }
+    
+    const size_t elem_size = elem.size;
+    char* kept = array;
+    char* end = array + n * elem_size;
+    for (char* elem_ptr = array + elem_size; elem_ptr != end; elem_ptr += elem_size) 
+    {
+        if (cmp(kept, elem_ptr) == 0) 
+        {
+            if (collapse->combine) 
+            {
+                collapse->combine(kept, elem_ptr);
+            }
+        } 
+        else 
+        {
+            kept += elem_size;
+            if (kept != elem_ptr) 
+            {
+                elem.copy(kept, elem_ptr);
+            }
+        }
+    }
+    
+    kept += elem_size;
+    mark_dead(collapse, kept, (size_t)(end - kept) / elem_size);
+    return (size_t)(kept - array) / elem_size;
+}
+
+// returns count of elements < pivot, counts of elements == pivot and > pivot go to the out parameters
+// with collapse the equal block shrinks to one element and the range loses equal_cnt - 1 slots at its end
+template <typename Element>
+static size_t partition_range(Element elem, char* src, size_t n, const char* pivot, cmp_func_t cmp, 
+                              char* dst, const Collapse* collapse, size_t* equal_cnt_out, size_t* greater_cnt_out) 
+{
+    const size_t elem_size = elem.size;
+    char* end = src + n * elem_size;
     
     size_t less_cnt = 0, equal_cnt = 0;
     
-    for (size_t i = 0; i < n; i++) 
+    for (char* elem_ptr = src; elem_ptr != end; elem_ptr += elem_size) 
     {
-        int res = cmp(src + i * elem_size, pivot);
+        int res = cmp(elem_ptr, pivot);
         if (res < 0) 
         {
             less_cnt++;
-        } 
+        }
         else if (res == 0) 
         {
             equal_cnt++;
         }
     }
     
-    size_t less_idx = 0;
-    size_t equal_idx = less_cnt;
-    size_t greater_idx = less_cnt + equal_cnt;
+    size_t kept_equal = collapse && equal_cnt > 0 ? 1 : equal_cnt;
+    char* less_ptr = dst;
+    char* equal_start = dst + less_cnt * elem_size;
+    char* equal_ptr = equal_start;
+    char* greater_ptr = dst + (less_cnt + kept_equal) * elem_size;
     
-    for (size_t i = 0; i < n; i++) 
+    for (char* elem_ptr = src; elem_ptr != end; elem_ptr += elem_size) 
     {
-        char* elem = src + i * elem_size;
-        int res = cmp(elem, pivot);
+        int res = cmp(elem_ptr, pivot);
         
         if (res < 0) 
         {
-            memcpy(dst + less_idx * elem_size, elem, elem_size);
-            less_idx++;
-        } 
+            elem.copy(less_ptr, elem_ptr);
+            less_ptr += elem_size;
+        }
         else if (res == 0) 
         {
-            memcpy(dst + equal_idx * elem_size, elem, elem_size);
-            equal_idx++;
-        } 
+            if (collapse && equal_ptr != equal_start) 
+            {
+                if (collapse->combine) 
+                {
+                    collapse->combine(equal_start, elem_ptr);
+                }
+            }
+            else 
+            {
+                elem.copy(equal_ptr, elem_ptr);
+                equal_ptr += elem_size;
+            }
+        }
         else 
         {
-            memcpy(dst + greater_idx * elem_size, elem, elem_size);
-            greater_idx++;
+            elem.copy(greater_ptr, elem_ptr);
+            greater_ptr += elem_size;
         }
     }
     
-    memcpy(src, dst, n * elem_size);
+    size_t kept = n - (equal_cnt - kept_equal);
+    memcpy(src, dst, kept * elem_size);
+    if (collapse) 
+    {
+        mark_dead(collapse, src + kept * elem_size, n - kept);
+    }
+    *equal_cnt_out = kept_equal;
+    *greater_cnt_out = n - less_cnt - equal_cnt;
     return less_cnt;
 }
 
-static void* select_pivot(void* array, size_t n, size_t elem_size, cmp_func_t cmp) 
+size_t stable_partition(void* array, size_t n, size_t elem_size, 
+                       void* pivot, cmp_func_t cmp, void* buffer) 
 {
-    char* arr = (char*)array;
+    size_t less_cnt = 0;
+    size_t equal_cnt = 0;
+    size_t greater_cnt = 0;
+    dispatch_element_size(elem_size, [&](auto elem) 
+    {
+        less_cnt = partition_range(elem, (char*)array, n, (const char*)pivot, cmp, (char*)buffer, NULL, 
+                                   &equal_cnt, &greater_cnt);
+    });
+    return less_cnt;
+}
+
+// array[0, sorted_n) and array[sorted_n, sorted_n + tail_n) are sorted, buffer holds at least tail_n elements
+template <typename Element>
+static void merge_runs(Element elem, char* array, size_t sorted_n, size_t tail_n, cmp_func_t cmp, char* buffer) 
+{
+    const size_t elem_size = elem.size;
+    if (sorted_n == 0 || tail_n == 0) 
+    {
+        return;
+    }
     
-    if (n <= 3) 
+    char* tail = array + sorted_n * elem_size;
+    if (cmp(tail - elem_size, tail) <= 0) 
     {
-        return arr;
+        return;
+    }
+    
+    // prefix elements <= first tail element are already in place
+    size_t lo = 0;
+    size_t hi = sorted_n;
+    while (lo < hi) 
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp(array + mid * elem_size, tail) <= 0) 
+        {
+            lo = mid + 1;
+        }
+        else 
+        {
+            hi = mid;
+        }
+    }
+    
+    memcpy(buffer, tail, tail_n * elem_size);
+    
+    char* first = array + lo * elem_size;
+    char* a = tail;                               // one past the last unmerged prefix element
+    char* b = buffer + tail_n * elem_size;        // one past the last unmerged tail element
+    char* out = tail + tail_n * elem_size;
+    while (b != buffer && a != first) 
+    {
+        out -= elem_size;
+        if (cmp(a - elem_size, b - elem_size) > 0) 
+        {
+            a -= elem_size;
+            elem.copy(out, a);
+        }
+        else 
+        {
+            b -= elem_size;
+            elem.copy(out, b);
+        }
     }
     
-    char* a = arr;
-    char* b = arr + (n / 2) * elem_size;
-    char* c = arr + (n - 1) * elem_size;
+    memcpy(first, buffer, (size_t)(b - buffer));
+}
+
+// bottom-up stable merge sort through buffer (n elements), O(n log n) whatever the pivots do
+template <typename Element>
+static void merge_sort_range(Element elem, char* array, size_t n, cmp_func_t cmp, char* buffer) 
+{
+    const size_t elem_size = elem.size;
+    for (size_t start = 0; start < n; start += THRESHOLD_INSERTION) 
+    {
+        size_t run = n - start < THRESHOLD_INSERTION ? n - start : THRESHOLD_INSERTION;
+        insertion_sort(elem, array + start * elem_size, run, cmp);
+    }
     
+    for (size_t width = THRESHOLD_INSERTION; width < n; width *= 2) 
+    {
+        for (size_t lo = 0; lo + width < n; lo += 2 * width) 
+        {
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            merge_runs(elem, array + lo * elem_size, width, hi - lo - width, cmp, buffer);
+        }
+    }
+}
+
+static char* median_of_three(char* a, char* b, char* c, cmp_func_t cmp) 
+{
     if (cmp(a, b) < 0) 
     {
         if (cmp(b, c) < 0) return b;
@@ -145,105 +352,331 @@ static void* select_pivot(void* array, size_t n, size_t elem_size, cmp_func_t cm
     }
 }
 
+#define NINTHER_THRESHOLD 128
+
+// median of three for small ranges, pseudo-median of nine (Tukey's ninther) for large ones:
+// plain median of first/middle/last degrades to O(n^2) on sawtooth and organ-pipe inputs
+static void* select_pivot(void* array, size_t n, size_t elem_size, cmp_func_t cmp) 
+{
+    char* arr = (char*)array;
+    
+    if (n <= 3) 
+    {
+        return arr;
+    }
+    
+    if (n <= NINTHER_THRESHOLD) 
+    {
+        return median_of_three(arr, arr + (n / 2) * elem_size, arr + (n - 1) * elem_size, cmp);
+    }
+    
+    size_t step = (n / 8) * elem_size;
+    char* a = median_of_three(arr, arr + step, arr + 2 * step, cmp);
+    char* b = median_of_three(arr + 3 * step, arr + 4 * step, arr + 5 * step, cmp);
+    char* c = median_of_three(arr + 6 * step, arr + 7 * step, arr + (n - 1) * elem_size, cmp);
+    return median_of_three(a, b, c, cmp);
+}
+
+#ifndef MAX_STACK_SIZE
 #define MAX_STACK_SIZE 128
+#endif
 typedef struct 
 {
     void* arr;
     size_t n;
+    size_t depth;
 } SortFrame;
 
-static void iterative_stable_sort(void* array, size_t n, size_t elem_size, 
-                                  cmp_func_t cmp, void* buffer)
+template <typename Element>
+static void iterative_stable_sort(Element elem, char* array, size_t n, cmp_func_t cmp, char* buffer, 
+                                  const Collapse* collapse) 
 {
+    const size_t elem_size = elem.size;
     SortFrame stack[MAX_STACK_SIZE];
     int top = 0;
     
     stack[top].arr = array;
     stack[top].n = n;
+    stack[top].depth = 0;
+    
+    // partitions deeper than 2 * log2(n) mean the pivots keep failing: switch that range to merge sort
+    size_t max_depth = 0;
+    for (size_t m = n; m > 1; m >>= 1) 
+    {
+        max_depth += 2;
+    }
     
-    char* temp_buffer = (char*)buffer;
+    char* temp_buffer = buffer;
     
     while (top >= 0) 
     {
-        void* curr_arr = stack[top].arr;
+        char* curr_arr = (char*)stack[top].arr;
         size_t curr_n = stack[top].n;
+        size_t depth = stack[top].depth;
         top--;
         
-        if (curr_n <= THRESHOLD_INSERTION) 
+        if (curr_n <= THRESHOLD_INSERTION || depth > max_depth) 
         {
-            optimized_insertion_sort((char*)curr_arr, curr_n, elem_size, cmp);
+            if (curr_n <= THRESHOLD_INSERTION) 
+            {
+                insertion_sort(elem, curr_arr, curr_n, cmp);
+            } 
+            else 
+            {
+                merge_sort_range(elem, curr_arr, curr_n, cmp, temp_buffer);
+            }
+            if (collapse) 
+            {
+                collapse_sorted(elem, curr_arr, curr_n, cmp, collapse);
+            }
             continue;
         }
         
         void* pivot_ptr = select_pivot(curr_arr, curr_n, elem_size, cmp);
         
         char* pivot_buf = temp_buffer;
-        memcpy(pivot_buf, pivot_ptr, elem_size);
+        elem.copy(pivot_buf, (const char*)pivot_ptr);
         
         char* partition_buf = temp_buffer + elem_size;
         
-        size_t left_size = stable_partition(curr_arr, curr_n, elem_size, 
-                                           pivot_buf, cmp, partition_buf);
-        char* curr_char = (char*)curr_arr;
         size_t equal_cnt = 0;
-        for (size_t i = left_size; i < curr_n; i++) 
+        size_t right_size = 0;
+        size_t left_size = partition_range(elem, curr_arr, curr_n, pivot_buf, cmp, partition_buf, collapse, 
+                                           &equal_cnt, &right_size);
+        
+        size_t right_start = left_size + equal_cnt;
+        
+        // the smaller side is pushed last and popped first, so the stack stays within log2(n) frames;
+        // a full stack still must not drop a range, it is merge sorted in place instead
+        auto push = [&](char* range, size_t range_n) 
         {
-            if (cmp(curr_char + i * elem_size, pivot_buf) == 0) 
+            if (range_n <= 1) 
             {
-                equal_cnt++;
-            } 
-            else 
+                return;
+            }
+            if (top + 1 < MAX_STACK_SIZE) 
             {
-                break;
+                top++;
+                stack[top].arr = range;
+                stack[top].n = range_n;
+                stack[top].depth = depth + 1;
+                return;
             }
-        }
-        
-        size_t right_start = left_size + equal_cnt;
-        size_t right_size = curr_n - right_start;
+            merge_sort_range(elem, range, range_n, cmp, temp_buffer);
+            if (collapse) 
+            {
+                collapse_sorted(elem, range, range_n, cmp, collapse);
+            }
+        };
         
+        char* right_arr = curr_arr + right_start * elem_size;
         if (right_size > left_size) 
         {
-            if (right_size > 1) 
+            push(right_arr, right_size);
+            push(curr_arr, left_size);
+        }
+        else 
+        {
+            push(curr_arr, left_size);
+            push(right_arr, right_size);
+        }
+    }
+}
+
+#define MULTIWAY_SPLITTERS 31
+#define MULTIWAY_OVERSAMPLING 8
+#define MULTIWAY_MIN_BYTES (1 << 20)
+#define MULTIWAY_MIN_SIZE 4096
+
+// one pass stable partition into buckets by sampled splitters (stable in-place samplesort step)
+// bucket 2j holds elements in (splitter[j-1], splitter[j]), bucket 2j+1 holds elements == splitter[j]
+// counts[b] = size of bucket b, return bucket count, 0 if the sample could not be allocated
+template <typename Element>
+static size_t multiway_partition(Element elem, char* array, size_t n, cmp_func_t cmp, 
+                                 char* buffer, unsigned char* bucket_ids, size_t* counts)
+{
+    const size_t elem_size = elem.size;
+    size_t sample_size = MULTIWAY_SPLITTERS * MULTIWAY_OVERSAMPLING;
+    char* sample = (char*)calloc(sample_size, elem_size);
+    if (!sample) 
+    {
+        return 0;
+    }
+    
+    size_t step = n / sample_size;
+    for (size_t i = 0; i < sample_size; i++) 
+    {
+        elem.copy(sample + i * elem_size, array + (i * step + step / 2) * elem_size);
+    }
+    insertion_sort(elem, sample, sample_size, cmp);
+    
+    // splitters are every MULTIWAY_OVERSAMPLING-th sample, duplicates are dropped
+    size_t splitter_cnt = 0;
+    for (size_t i = 1; i <= MULTIWAY_SPLITTERS; i++) 
+    {
+        char* candidate = sample + (i * MULTIWAY_OVERSAMPLING - MULTIWAY_OVERSAMPLING / 2) * elem_size;
+        if (splitter_cnt == 0 || cmp(sample + (splitter_cnt - 1) * elem_size, candidate) != 0) 
+        {
+            memmove(sample + splitter_cnt * elem_size, candidate, elem_size);
+            splitter_cnt++;
+        }
+    }
+    
+    size_t bucket_cnt = 2 * splitter_cnt + 1;
+    memset(counts, 0, bucket_cnt * sizeof(size_t));
+    char* end = array + n * elem_size;
+    unsigned char* id = bucket_ids;
+    for (char* elem_ptr = array; elem_ptr != end; elem_ptr += elem_size, id++) 
+    {
+        size_t lo = 0;
+        size_t hi = splitter_cnt;
+        size_t bucket = SIZE_MAX;
+        while (lo < hi) 
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            int res = cmp(elem_ptr, sample + mid * elem_size);
+            if (res == 0) 
             {
-                if (top + 1 < MAX_STACK_SIZE) 
-                {
-                    top++;
-                    stack[top].arr = (char*)curr_arr + right_start * elem_size;
-                    stack[top].n = right_size;
-                }
+                bucket = 2 * mid + 1;
+                break;
             }
-            if (left_size > 1) 
+            if (res < 0) 
             {
-                if (top + 1 < MAX_STACK_SIZE) 
-                {
-                    top++;
-                    stack[top].arr = curr_arr;
-                    stack[top].n = left_size;
-                }
+                hi = mid;
             }
-        } 
-        else 
-        {
-            if (left_size > 1) 
+            else 
             {
-                if (top + 1 < MAX_STACK_SIZE) 
-                {
-                    top++;
-                    stack[top].arr = curr_arr;
-                    stack[top].n = left_size;
-                }
+                lo = mid + 1;
             }
-            if (right_size > 1) 
+        }
+        if (bucket == SIZE_MAX) 
+        {
+            bucket = 2 * lo;
+        }
+        *id = (unsigned char)bucket;
+        counts[bucket]++;
+    }
+    free(sample);
+    
+    char* outputs[2 * MULTIWAY_SPLITTERS + 1];
+    size_t sum = 0;
+    for (size_t b = 0; b < bucket_cnt; b++) 
+    {
+        outputs[b] = buffer + sum * elem_size;
+        sum += counts[b];
+    }
+    id = bucket_ids;
+    for (char* elem_ptr = array; elem_ptr != end; elem_ptr += elem_size, id++) 
+    {
+        elem.copy(outputs[*id], elem_ptr);
+        outputs[*id] += elem_size;
+    }
+    memcpy(array, buffer, n * elem_size);
+    return bucket_cnt;
+}
+
+// equal buckets are final, the other buckets are partitioned again depth first while they are out of cache
+// the sample positions are fixed, so an input can put the largest keys there on every level and each level
+// then peels off only the sampled elements: like the binary sort, a bucket holding more than half of its
+// range or deeper than the depth budget goes to iterative_stable_sort, which falls back to merge sort
+template <typename Element>
+static void multiway_stable_sort(Element elem, char* array, size_t n, cmp_func_t cmp, 
+                                 char* buffer, unsigned char* bucket_ids, const Collapse* collapse)
+{
+    const size_t elem_size = elem.size;
+    
+    // twice the levels a balanced split needs to get below MULTIWAY_MIN_SIZE
+    size_t max_depth = 2;
+    for (size_t m = n / MULTIWAY_MIN_SIZE; m > 1; m /= MULTIWAY_SPLITTERS + 1) 
+    {
+        max_depth += 2;
+    }
+    
+    // every level leaves at most MULTIWAY_SPLITTERS + 1 frames on the stack
+    size_t max_frames = (max_depth + 2) * (MULTIWAY_SPLITTERS + 1);
+    SortFrame* stack = (SortFrame*)calloc(max_frames, sizeof(SortFrame));
+    if (!stack) 
+    {
+        iterative_stable_sort(elem, array, n, cmp, buffer, collapse);
+        return;
+    }
+    
+    size_t top = 0;
+    stack[top].arr = array;
+    stack[top].n = n;
+    stack[top].depth = 0;
+    top++;
+    
+    size_t counts[2 * MULTIWAY_SPLITTERS + 1];
+    while (top > 0) 
+    {
+        top--;
+        char* curr_arr = (char*)stack[top].arr;
+        size_t curr_n = stack[top].n;
+        size_t depth = stack[top].depth;
+        
+        size_t bucket_cnt = 0;
+        if (curr_n >= MULTIWAY_MIN_SIZE && curr_n * elem_size >= MULTIWAY_MIN_BYTES && depth <= max_depth) 
+        {
+            bucket_cnt = multiway_partition(elem, curr_arr, curr_n, cmp, buffer, bucket_ids, counts);
+        }
+        if (bucket_cnt == 0) 
+        {
+            iterative_stable_sort(elem, curr_arr, curr_n, cmp, buffer, collapse);
+            continue;
+        }
+        
+        size_t start = 0;
+        for (size_t b = 0; b < bucket_cnt; b++) 
+        {
+            char* bucket = curr_arr + start * elem_size;
+            if (b % 2 == 0 && counts[b] > curr_n / 2) 
             {
-                if (top + 1 < MAX_STACK_SIZE) 
-                {
-                    top++;
-                    stack[top].arr = (char*)curr_arr + right_start * elem_size;
-                    stack[top].n = right_size;
-                }
+                iterative_stable_sort(elem, bucket, counts[b], cmp, buffer, collapse);
+            } 
+            else if (b % 2 == 0 && counts[b] > 1) 
+            {
+                stack[top].arr = bucket;
+                stack[top].n = counts[b];
+                stack[top].depth = depth + 1;
+                top++;
+            } 
+            else if (b % 2 == 1 && collapse) 
+            {
+                collapse_sorted(elem, bucket, counts[b], cmp, collapse);
             }
+            start += counts[b];
         }
     }
+    free(stack);
+}
+
+template <typename Element>
+static void sort_range(Element elem, char* array, size_t n, cmp_func_t cmp, char* buffer, 
+                       const Collapse* collapse) 
+{
+    if (n <= THRESHOLD_INSERTION) 
+    {
+        insertion_sort(elem, array, n, cmp);
+        if (collapse) 
+        {
+            collapse_sorted(elem, array, n, cmp, collapse);
+        }
+        return;
+    }
+    
+    if (n >= MULTIWAY_MIN_SIZE && n * elem.size >= MULTIWAY_MIN_BYTES) 
+    {
+        unsigned char* bucket_ids = (unsigned char*)calloc(n, sizeof(unsigned char));
+        if (bucket_ids) 
+        {
+            multiway_stable_sort(elem, array, n, cmp, buffer, bucket_ids, collapse);
+            free(bucket_ids);
+            return;
+        }
+    }
+    
+    iterative_stable_sort(elem, array, n, cmp, buffer, collapse);
 }
 
 void logsort_recursive(void* array, size_t size_of_array, size_t size_of_element, 
@@ -254,36 +687,259 @@ void logsort_recursive(void* array, size_t size_of_array, size_t size_of_element
         return;
     }
     
+    dispatch_element_size(size_of_element, [&](auto elem) 
+    {
+        sort_range(elem, (char*)array, size_of_array, cmp, (char*)buffer, NULL);
+    });
+}
+
+void logsort(void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp) 
+{
+    if (!array || size_of_array <= 1) 
+    {
+        return;
+    }
+    
     if (size_of_array <= THRESHOLD_INSERTION) 
     {
         optimized_insertion_sort((char*)array, size_of_array, size_of_element, cmp);
         return;
     }
     
-    iterative_stable_sort(array, size_of_array, size_of_element, cmp, buffer);
+    unsigned flags = LOGSORT_ALLOC_DEFAULT;
+    size_t touch_threads = 1;
+    logsort_get_scratch_policy(&flags, &touch_threads);
+    
+    LogsortBuffer buffer;
+    size_t buffer_size = (size_of_array + 1) * size_of_element;
+    // a policy the system refuses (no mbind, no huge pages) still gets a plain scratch buffer
+    if (logsort_buffer_alloc(&buffer, buffer_size, flags, touch_threads) != 0 && 
+        logsort_buffer_alloc(&buffer, buffer_size, LOGSORT_ALLOC_DEFAULT, 1) != 0) 
+    {
+        optimized_insertion_sort((char*)array, size_of_array, size_of_element, cmp);
+        return;
+    }
+    
+    logsort_recursive(array, size_of_array, size_of_element, cmp, buffer.data);
+    logsort_buffer_free(&buffer);
+
+#ifdef LOGSORT_POSTCONDITION
+    LOGSORT_CHECK_SORTED(array, size_of_array, size_of_element, cmp);
+#endif
 }
 
-void logsort(void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp) 
+static size_t logsort_collapse(void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                               combine_func_t combine) 
 {
     if (!array || size_of_array <= 1) 
+    {
+        return array ? size_of_array : 0;
+    }
+    
+    char* buffer = (char*)calloc(size_of_array + 1, size_of_element);
+    unsigned char* dead = (unsigned char*)calloc(size_of_array, sizeof(unsigned char));
+    Collapse collapse = {combine, dead, (char*)array, size_of_element};
+    if (!buffer || !dead) 
+    {
+        free(buffer);
+        free(dead);
+        collapse.dead = NULL;
+        size_t kept = 0;
+        dispatch_element_size(size_of_element, [&](auto elem) 
+        {
+            insertion_sort(elem, (char*)array, size_of_array, cmp);
+            kept = collapse_sorted(elem, (char*)array, size_of_array, cmp, &collapse);
+        });
+        return kept;
+    }
+    
+    dispatch_element_size(size_of_element, [&](auto elem) 
+    {
+        sort_range(elem, (char*)array, size_of_array, cmp, buffer, &collapse);
+    });
+    free(buffer);
+    
+    // live elements are in sorted order with dead slots between them, squeeze them together
+    char* arr = (char*)array;
+    size_t kept = 0;
+    for (size_t i = 0; i < size_of_array; i++) 
+    {
+        if (!dead[i]) 
+        {
+            if (kept != i) 
+            {
+                memcpy(arr + kept * size_of_element, arr + i * size_of_element, size_of_element);
+            }
+            kept++;
+        }
+    }
+    free(dead);
+    return kept;
+}
+
+size_t logsort_unique(void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp) 
+{
+    return logsort_collapse(array, size_of_array, size_of_element, cmp, NULL);
+}
+
+size_t logsort_reduce(void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                      combine_func_t combine) 
+{
+    return logsort_collapse(array, size_of_array, size_of_element, cmp, combine);
+}
+
+static void merge_sorted_tail(char* array, size_t sorted_n, size_t tail_n, size_t elem_size, 
+                              cmp_func_t cmp, char* buffer)
+{
+    dispatch_element_size(elem_size, [&](auto elem) 
+    {
+        merge_runs(elem, array, sorted_n, tail_n, cmp, buffer);
+    });
+}
+
+void logsort_merge(void* array, size_t sorted_size, size_t size_of_array, size_t size_of_element, 
+                   cmp_func_t cmp, void* buffer) 
+{
+    if (!array || !buffer || size_of_array <= sorted_size) 
     {
         return;
     }
     
-    if (size_of_array <= THRESHOLD_INSERTION) 
+    merge_sorted_tail((char*)array, sorted_size, size_of_array - sorted_size, size_of_element, cmp, (char*)buffer);
+}
+
+void logsort_append(void* array, size_t sorted_size, size_t size_of_array, size_t size_of_element, 
+                    cmp_func_t cmp) 
+{
+    if (!array || size_of_array <= sorted_size) 
     {
-        optimized_insertion_sort((char*)array, size_of_array, size_of_element, cmp);
         return;
     }
     
-    size_t buffer_size = (size_of_array + 1) * size_of_element;
-    void* buffer = calloc(buffer_size, sizeof(void));
+    if (sorted_size == 0) 
+    {
+        logsort(array, size_of_array, size_of_element, cmp);
+        return;
+    }
+    
+    size_t tail_size = size_of_array - sorted_size;
+    char* tail = (char*)array + sorted_size * size_of_element;
+    
+    size_t buffer_size = (tail_size + 1) * size_of_element;
+    char* buffer = (char*)calloc(buffer_size, sizeof(char));
     if (!buffer) 
     {
         optimized_insertion_sort((char*)array, size_of_array, size_of_element, cmp);
         return;
     }
     
-    logsort_recursive(array, size_of_array, size_of_element, cmp, buffer);
+    logsort_recursive(tail, tail_size, size_of_element, cmp, buffer);
+    merge_sorted_tail((char*)array, sorted_size, tail_size, size_of_element, cmp, buffer);
     free(buffer);
-}
\ No newline at end of file
+}
+
+int logsort_stream_init(LogsortStream* stream, size_t size_of_element, cmp_func_t cmp) 
+{
+    if (!stream || size_of_element == 0 || !cmp) 
+    {
+        return -1;
+    }
+    
+    stream->data = NULL;
+    stream->capacity = 0;
+    stream->size_of_element = size_of_element;
+    stream->emitted = 0;
+    stream->sorted = 0;
+    stream->count = 0;
+    stream->cmp = cmp;
+    return 0;
+}
+
+int logsort_stream_push(LogsortStream* stream, const void* elements, size_t count) 
+{
+    if (!stream || (!elements && count > 0)) 
+    {
+        return -1;
+    }
+    
+    size_t elem_size = stream->size_of_element;
+    
+    // drop the emitted prefix once it is at least half of the storage
+    if (stream->emitted > 0 && stream->emitted * 2 >= stream->count) 
+    {
+        memmove(stream->data, stream->data + stream->emitted * elem_size, 
+                (stream->count - stream->emitted) * elem_size);
+        stream->sorted -= stream->emitted;
+        stream->count -= stream->emitted;
+        stream->emitted = 0;
+    }
+    
+    if (stream->count + count > stream->capacity) 
+    {
+        size_t new_cap = stream->capacity ? stream->capacity * 2 : 128;
+        while (new_cap < stream->count + count) 
+        {
+            new_cap *= 2;
+        }
+        char* tmp = (char*)realloc(stream->data, new_cap * elem_size);
+        if (!tmp) 
+        {
+            return -1;
+        }
+        stream->data = tmp;
+        stream->capacity = new_cap;
+    }
+    
+    if (count > 0) 
+    {
+        memcpy(stream->data + stream->count * elem_size, elements, count * elem_size);
+    }
+    stream->count += count;
+    return 0;
+}
+
+const void* logsort_stream_next(LogsortStream* stream, const void* watermark) 
+{
+    if (!stream) 
+    {
+        return NULL;
+    }
+    
+    size_t elem_size = stream->size_of_element;
+    
+    if (stream->sorted < stream->count) 
+    {
+        logsort_append(stream->data + stream->emitted * elem_size, stream->sorted - stream->emitted, 
+                       stream->count - stream->emitted, elem_size, stream->cmp);
+        stream->sorted = stream->count;
+    }
+    
+    if (stream->emitted >= stream->count) 
+    {
+        return NULL;
+    }
+    
+    char* elem = stream->data + stream->emitted * elem_size;
+    if (watermark && stream->cmp(elem, watermark) > 0) 
+    {
+        return NULL;
+    }
+    
+    stream->emitted++;
+    return elem;
+}
+
+void logsort_stream_destroy(LogsortStream* stream) 
+{
+    if (!stream) 
+    {
+        return;
+    }
+    
+    free(stream->data);
+    stream->data = NULL;
+    stream->capacity = 0;
+    stream->emitted = 0;
+    stream->sorted = 0;
+    stream->count = 0;
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "logsort_columns.h"
+
+// gather dst[i] = src[perm[i]] for one column: dst is written sequentially, src is read in permutation order
+static void gather_column(char* dst, const char* src, const size_t* perm, size_t n, size_t elem_size)
+{
+    switch (elem_size) 
+    {
+        case 4:
+            for (size_t i = 0; i < n; i++) 
+            {
+                uint32_t v;
+                memcpy(&v, src + perm[i] * 4, 4);
+                memcpy(dst + i * 4, &v, 4);
+            }
+            break;
+        case 8:
+            for (size_t i = 0; i < n; i++) 
+            {
+                uint64_t v;
+                memcpy(&v, src + perm[i] * 8, 8);
+                memcpy(dst + i * 8, &v, 8);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < n; i++) 
+            {
+                memcpy(dst + i * elem_size, src + perm[i] * elem_size, elem_size);
+            }
+            break;
+    }
+}
+
+int logsort_columns(void* keys, size_t size_of_array, size_t size_of_key, cmp_func_t cmp, 
+                    void** columns, const size_t* column_sizes, size_t column_count) 
+{
+    if (size_of_array <= 1) 
+    {
+        return 0;
+    }
+    
+    if (!keys || !cmp || size_of_key == 0 || (column_count > 0 && (!columns || !column_sizes))) 
+    {
+        return -1;
+    }
+    
+    // record = key (at offset 0, so cmp works on it directly) + original index
+    size_t index_offset = (size_of_key + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+    size_t record_size = index_offset + sizeof(size_t);
+    
+    size_t max_column_size = 0;
+    for (size_t c = 0; c < column_count; c++) 
+    {
+        if (column_sizes[c] > max_column_size) 
+        {
+            max_column_size = column_sizes[c];
+        }
+    }
+    
+    char* records = (char*)calloc(size_of_array, record_size);
+    size_t* perm = (size_t*)calloc(size_of_array, sizeof(size_t));
+    char* scratch = max_column_size ? (char*)calloc(size_of_array, max_column_size) : NULL;
+    if (!records || !perm || (max_column_size && !scratch)) 
+    {
+        free(records);
+        free(perm);
+        free(scratch);
+        return -1;
+    }
+    
+    const char* key_src = (const char*)keys;
+    for (size_t i = 0; i < size_of_array; i++) 
+    {
+        memcpy(records + i * record_size, key_src + i * size_of_key, size_of_key);
+        memcpy(records + i * record_size + index_offset, &i, sizeof(size_t));
+    }
+    
+    logsort(records, size_of_array, record_size, cmp);
+    
+    char* key_dst = (char*)keys;
+    for (size_t i = 0; i < size_of_array; i++) 
+    {
+        memcpy(key_dst + i * size_of_key, records + i * record_size, size_of_key);
+        memcpy(&perm[i], records + i * record_size + index_offset, sizeof(size_t));
+    }
+    free(records);
+    
+    for (size_t c = 0; c < column_count; c++) 
+    {
+        if (!columns[c] || column_sizes[c] == 0) 
+        {
+            continue;
+        }
+        gather_column(scratch, (const char*)columns[c], perm, size_of_array, column_sizes[c]);
+        memcpy(columns[c], scratch, size_of_array * column_sizes[c]);
+    }
+    
+    free(perm);
+    free(scratch);
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "logsort_verify.h"
+#include "logsort_columns.h"
+
+#define VERIFY_MIN_CHUNK (1 << 16)
+
+// first violation in [begin, end), element begin is compared with begin - 1
+static size_t check_chunk(const char* array, const size_t* original_index, size_t begin, size_t end, 
+                          size_t elem_size, cmp_func_t cmp)
+{
+    for (size_t i = begin; i < end; i++) 
+    {
+        int res = cmp(array + (i - 1) * elem_size, array + i * elem_size);
+        if (res > 0) 
+        {
+            return i;
+        }
+        if (res == 0 && original_index && original_index[i - 1] > original_index[i]) 
+        {
+            return i;
+        }
+    }
+    return end;
+}
+
+static size_t check_parallel(const char* array, const size_t* original_index, size_t n, size_t elem_size, 
+                             cmp_func_t cmp, size_t thread_count)
+{
+    if (n <= 1) 
+    {
+        return n;
+    }
+    
+    if (thread_count == 0) 
+    {
+        thread_count = std::thread::hardware_concurrency();
+    }
+    size_t max_threads = n / VERIFY_MIN_CHUNK;
+    if (thread_count > max_threads) 
+    {
+        thread_count = max_threads;
+    }
+    if (thread_count <= 1) 
+    {
+        return check_chunk(array, original_index, 1, n, elem_size, cmp);
+    }
+    
+    // no exception may leave the C interface: without memory the check runs serially,
+    // a chunk whose thread cannot be started is checked on the calling thread
+    std::vector<size_t> results;
+    std::vector<std::thread> threads;
+    try 
+    {
+        results.assign(thread_count, n);
+        threads.reserve(thread_count);
+    } 
+    catch (...) 
+    {
+        return check_chunk(array, original_index, 1, n, elem_size, cmp);
+    }
+    size_t chunk = (n - 1 + thread_count - 1) / thread_count;
+    for (size_t t = 0; t < thread_count; t++) 
+    {
+        size_t begin = 1 + t * chunk;
+        size_t end = begin + chunk < n ? begin + chunk : n;
+        if (begin >= end) 
+        {
+            break;
+        }
+        auto check = [&results, t, array, original_index, begin, end, elem_size, cmp]() 
+        {
+            size_t res = check_chunk(array, original_index, begin, end, elem_size, cmp);
+            if (res < end) 
+            {
+                results[t] = res;
+            }
+        };
+        try 
+        {
+            threads.emplace_back(check);
+        } 
+        catch (...) 
+        {
+            check();
+        }
+    }
+    for (std::thread& th : threads) 
+    {
+        th.join();
+    }
+    
+    for (size_t t = 0; t < thread_count; t++) 
+    {
+        if (results[t] < n) 
+        {
+            return results[t];
+        }
+    }
+    return n;
+}
+
+size_t logsort_sorted_until(const void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                            size_t thread_count) 
+{
+    if (!array || !cmp) 
+    {
+        return 0;
+    }
+    return check_parallel((const char*)array, NULL, size_of_array, size_of_element, cmp, thread_count);
+}
+
+size_t logsort_stable_until(const void* array, const size_t* original_index, size_t size_of_array, 
+                            size_t size_of_element, cmp_func_t cmp, size_t thread_count) 
+{
+    if (!array || !original_index || !cmp) 
+    {
+        return 0;
+    }
+    return check_parallel((const char*)array, original_index, size_of_array, size_of_element, cmp, thread_count);
+}
+
+int logsort_sample_sorted(const void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                          size_t samples) 
+{
+    if (!array || !cmp) 
+    {
+        return 0;
+    }
+    if (size_of_array <= 1) 
+    {
+        return 1;
+    }
+    
+    const char* arr = (const char*)array;
+    size_t pairs = size_of_array - 1;
+    if (samples == 0 || samples >= pairs) 
+    {
+        return check_chunk(arr, NULL, 1, size_of_array, size_of_element, cmp) == size_of_array;
+    }
+    
+    for (size_t s = 0; s < samples; s++) 
+    {
+        size_t i = 1 + s * pairs / samples;
+        if (cmp(arr + (i - 1) * size_of_element, arr + i * size_of_element) > 0) 
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int logsort_tagged(void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                   size_t* original_index) 
+{
+    if (!original_index) 
+    {
+        return -1;
+    }
+    
+    for (size_t i = 0; i < size_of_array; i++) 
+    {
+        original_index[i] = i;
+    }
+    
+    void* columns[] = {original_index};
+    size_t column_sizes[] = {sizeof(size_t)};
+    return logsort_columns(array, size_of_array, size_of_element, cmp, columns, column_sizes, 1);
+}
+
+void logsort_check_sorted(const void* array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, 
+                          int full, const char* file, int line) 
+{
+    if (full) 
+    {
+        size_t bad = logsort_sorted_until(array, size_of_array, size_of_element, cmp, 0);
+        if (bad < size_of_array) 
+        {
+            fprintf(stderr, "%s:%d: array of %zu elements is not sorted at i=%zu\n", 
+                    file, line, size_of_array, bad);
+            abort();
+        }
+    } 
+    else if (!logsort_sample_sorted(array, size_of_array, size_of_element, cmp, LOGSORT_VERIFY_SAMPLES)) 
+    {
+        fprintf(stderr, "%s:%d: array of %zu elements is not sorted (sampled check)\n", 
+                file, line, size_of_array);
+        abort();
+    }
+}
@@ -2,8 +2,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
 
 #include "logsort.h"
+#include "logsort_alloc.h"
+#include "logsort_executor.h"
+#include "corpus.h"
 
 typedef struct 
 {
@@ -20,17 +28,181 @@ int cmp_item(const void *pa, const void *pb)
     return 0;
 }
 
+static int cmp_key(const void *pa, const void *pb) 
+{
+    int a = *(const int *)pa;
+    int b = *(const int *)pb;
+    if (a < b) return -1;
+    if (a > b) return +1;
+    return 0;
+}
+
+static double now_sec(void) 
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) 
+    {
+        return 0.0;
+    }
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// copies the input into elem_size-byte elements and sorts them, elem_size is 4 (key only) or >= sizeof(Item)
+static int sort_elements(const Item *arr, size_t n, size_t elem_size, int use_logsort) 
+{
+    if (elem_size != sizeof(int) && elem_size < sizeof(Item)) 
+    {
+        fprintf(stderr, "Element size must be 4 or at least %zu\n", sizeof(Item));
+        return 1;
+    }
+
+    char *elements = (char *)calloc(n, elem_size);
+    if (!elements) 
+    {
+        fprintf(stderr, "Memory error (elements)\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) 
+    {
+        memcpy(elements + i * elem_size, &arr[i], elem_size < sizeof(Item) ? elem_size : sizeof(Item));
+    }
+
+    cmp_func_t cmp = elem_size == sizeof(int) ? cmp_key : cmp_item;
+    double t0 = now_sec();
+    if (use_logsort) 
+    {
+        logsort(elements, n, elem_size, cmp);
+    } 
+    else 
+    {
+        qsort(elements, n, elem_size, cmp);
+    }
+    printf("sort_time=%.9f\n", now_sec() - t0);
+
+    free(elements);
+    return 0;
+}
+
+// closed loop: every client sorts a fresh slice of the input and submits the next one only when it is done
+// prints throughput (jobs/s), p50 and p99 latency (s)
+static int run_service_load(const Item *input, size_t n, size_t clients, size_t jobs, size_t job_size, 
+                            int use_executor) 
+{
+    if (clients == 0 || jobs == 0 || job_size == 0 || job_size > n) 
+    {
+        fprintf(stderr, "Bad load parameters\n");
+        return 1;
+    }
+
+    LogsortExecutor *executor = use_executor ? logsort_executor_create(0) : NULL;
+    std::vector<double> latencies(clients * jobs);
+    std::vector<std::thread> threads;
+
+    double t0 = now_sec();
+    for (size_t c = 0; c < clients; c++) 
+    {
+        threads.emplace_back([&latencies, executor, input, n, c, jobs, job_size]() 
+        {
+            std::vector<Item> slice(job_size);
+            size_t offset = (c * 7919) % (n - job_size + 1);
+            for (size_t j = 0; j < jobs; j++) 
+            {
+                memcpy(slice.data(), input + offset, job_size * sizeof(Item));
+                offset = (offset + 104729) % (n - job_size + 1);
+
+                double start = now_sec();
+                if (executor) 
+                {
+                    logsort_job_wait(logsort_executor_submit(executor, slice.data(), job_size, sizeof(Item), 
+                                                             cmp_item, NULL, NULL));
+                } 
+                else 
+                {
+                    logsort(slice.data(), job_size, sizeof(Item), cmp_item);
+                }
+                latencies[c * jobs + j] = now_sec() - start;
+            }
+        });
+    }
+    for (std::thread &th : threads) 
+    {
+        th.join();
+    }
+    double total = now_sec() - t0;
+    logsort_executor_destroy(executor);
+
+    std::sort(latencies.begin(), latencies.end());
+    size_t count = latencies.size();
+    printf("throughput=%.3f p50=%.9f p99=%.9f\n", (double)count / total, 
+           latencies[count / 2], latencies[(count * 99) / 100 < count ? (count * 99) / 100 : count - 1]);
+    return 0;
+}
+
 int main(int argc, char **argv) 
 {
     if (argc < 3) 
     {
-        fprintf(stderr, "Usage: %s input_file mode(logsort|qsort)\n", argv[0]);
+        fprintf(stderr, "Usage: %s input_file mode(logsort|qsort)[:elem_size] [alloc_policy(default|thp|hugetlb|interleave) [touch_threads]]\n", argv[0]);
+        fprintf(stderr, "       (prints sort_time=seconds of the sort alone)\n");
+        fprintf(stderr, "       %s input_file mode(service|service_sync) clients jobs_per_client job_size\n", argv[0]);
+        fprintf(stderr, "       %s corpus_dir gen distribution n density elem_size seed\n", argv[0]);
+        fprintf(stderr, "       %s corpus_dir regress golden_file baseline_file [tolerance [repeats]]\n", argv[0]);
         return 1;
     }
 
     const char *filename = argv[1];
     const char *mode = argv[2];
 
+    if (strcmp(mode, "gen") == 0) 
+    {
+        if (argc < 8) 
+        {
+            fprintf(stderr, "Mode 'gen' needs distribution, n, density, elem_size and seed\n");
+            return 1;
+        }
+        CorpusKey key = {argv[3], strtoul(argv[4], NULL, 10), strtod(argv[5], NULL), strtoul(argv[6], NULL, 10), 
+                         strtoull(argv[7], NULL, 10)};
+        void *data = NULL;
+        if (corpus_load(&key, filename, &data) != 0) 
+        {
+            fprintf(stderr, "Cannot generate dataset\n");
+            return 1;
+        }
+        free(data);
+        char path[CORPUS_PATH_SIZE];
+        corpus_path(&key, filename, path, sizeof(path));
+        printf("%s\n", path);
+        return 0;
+    }
+
+    if (strcmp(mode, "regress") == 0) 
+    {
+        if (argc < 5) 
+        {
+            fprintf(stderr, "Mode 'regress' needs a golden checksum file and a throughput baseline file\n");
+            return 1;
+        }
+        double tolerance = argc >= 6 ? strtod(argv[5], NULL) : 0.1;
+        size_t repeats = argc >= 7 ? strtoul(argv[6], NULL, 10) : 5;
+        int res = corpus_regress(filename, argv[3], argv[4], tolerance, repeats);
+        return res == 0 ? 0 : 1;
+    }
+
+    int service = strcmp(mode, "service") == 0 || strcmp(mode, "service_sync") == 0;
+    if (service && argc < 6) 
+    {
+        fprintf(stderr, "Mode '%s' needs clients, jobs_per_client and job_size\n", mode);
+        return 1;
+    }
+
+    unsigned alloc_flags = LOGSORT_ALLOC_DEFAULT;
+    if (!service && argc >= 4 && logsort_parse_alloc_policy(argv[3], &alloc_flags) != 0) 
+    {
+        fprintf(stderr, "Unknown alloc policy '%s'\n", argv[3]);
+        return 1;
+    }
+    size_t touch_threads = !service && argc >= 5 ? strtoul(argv[4], NULL, 10) : 1;
+
     FILE *f = fopen(filename, "r");
     if (!f) 
     {
@@ -70,18 +242,76 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    if (strcmp(mode, "logsort") == 0) 
+    if (service) 
+    {
+        int res = run_service_load(arr, n, strtoul(argv[3], NULL, 10), strtoul(argv[4], NULL, 10), 
+                                   strtoul(argv[5], NULL, 10), strcmp(mode, "service") == 0);
+        free(arr);
+        return res;
+    }
+
+    // move the input into a buffer with the requested placement, scratch uses the same policy
+    LogsortBuffer input;
+    int placed = 0;
+    if (alloc_flags != LOGSORT_ALLOC_DEFAULT || touch_threads > 1) 
+    {
+        if (logsort_buffer_alloc(&input, n * sizeof(Item), alloc_flags, touch_threads) != 0) 
+        {
+            fprintf(stderr, "Memory error (alloc policy)\n");
+            free(arr);
+            return 1;
+        }
+        memcpy(input.data, arr, n * sizeof(Item));
+        free(arr);
+        arr = (Item *)input.data;
+        placed = 1;
+        logsort_set_scratch_policy(alloc_flags, touch_threads);
+    }
+
+    // "logsort:16" sorts 16-byte elements: the Item (or only the key for 4 bytes) followed by zero padding
+    const char *colon = strchr(mode, ':');
+    size_t name_len = colon ? (size_t)(colon - mode) : strlen(mode);
+    size_t elem_size = colon ? strtoul(colon + 1, NULL, 10) : sizeof(Item);
+    int use_logsort = name_len == 7 && strncmp(mode, "logsort", name_len) == 0;
+    int use_qsort = name_len == 5 && strncmp(mode, "qsort", name_len) == 0;
+
+    if ((use_logsort || use_qsort) && elem_size != sizeof(Item)) 
+    {
+        int res = sort_elements(arr, n, elem_size, use_logsort);
+        if (placed) 
+        {
+            logsort_buffer_free(&input);
+        } 
+        else 
+        {
+            free(arr);
+        }
+        return res;
+    }
+
+    // only the sort itself is timed, without reading and parsing the input
+    double t0 = now_sec();
+    if (use_logsort) 
     {
         logsort(arr, n, sizeof(Item), cmp_item);
+        printf("sort_time=%.9f\n", now_sec() - t0);
     } 
-    else if (strcmp(mode, "qsort") == 0) 
+    else if (use_qsort) 
     {
         qsort(arr, n, sizeof(Item), cmp_item);
+        printf("sort_time=%.9f\n", now_sec() - t0);
     } 
     else 
     {
         fprintf(stderr, "Unknown mode '%s'. Use logsort or qsort\n", mode);
-        free(arr);
+        if (placed) 
+        {
+            logsort_buffer_free(&input);
+        } 
+        else 
+        {
+            free(arr);
+        }
         return 1;
     }
 
@@ -91,6 +321,13 @@ int main(int argc, char **argv)
     // }
     // printf("\n");
 
-    free(arr);
+    if (placed) 
+    {
+        logsort_buffer_free(&input);
+    } 
+    else 
+    {
+        free(arr);
+    }
     return 0;
 }
@@ -0,0 +1,602 @@
+// Differential fuzz target: every logsort entry point against std::stable_sort, compared byte for byte
+//
+// libFuzzer:  make libfuzzer && build/libfuzzer.exe corpus_dir
+// AFL:        afl-fuzz -i seeds -o findings -- build/fuzz.exe @@
+// property:   build/fuzz.exe [iterations [seed]]     (generates inputs, no fuzzer needed)
+// replay:     build/fuzz.exe crash_file...           ("-" reads stdin)
+//
+// input layout:
+//   [0] element size (index into ELEMENT_SIZES)   [1] operation   [2] distribution
+//   [3..5] element count   [6] parameter (key range / period / split point / batch size / job count)
+//   [7..14] generator seed   [15..] keys for DIST_RAW
+// keys live in the first min(size_of_element, 4) bytes, the rest of an element is a payload derived from
+// its input position, so any instability or corruption shows up in the byte comparison
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "logsort.h"
+#include "logsort_columns.h"
+#include "logsort_executor.h"
+#include "logsort_verify.h"
+
+#define FUZZ_MAX_SIZE (1 << 20)
+#define FUZZ_MAX_BYTES (4 << 20)
+#define FUZZ_HEADER_SIZE 15
+#define FUZZ_CRASH_FILE "fuzz_crash.bin"
+
+// covers specialized kernels, odd generic sizes and sizes above MERGE_BUFFER_SIZE (256)
+static const size_t ELEMENT_SIZES[] = {1, 2, 3, 4, 5, 7, 8, 12, 16, 24, 32, 33, 64, 100, 255, 256, 257, 300, 520};
+#define ELEMENT_SIZE_COUNT (sizeof(ELEMENT_SIZES) / sizeof(ELEMENT_SIZES[0]))
+
+enum FuzzOperation
+{
+    OP_SORT,
+    OP_RECURSIVE,
+    OP_APPEND,
+    OP_UNIQUE,
+    OP_REDUCE,
+    OP_STREAM,
+    OP_STREAM_WATERMARK,
+    OP_MERGE,
+    OP_COLUMNS,
+    OP_TAGGED,
+    OP_EXECUTOR,
+    OP_COUNT
+};
+
+enum FuzzDistribution
+{
+    DIST_RAW,
+    DIST_RANDOM,
+    DIST_SORTED,
+    DIST_REVERSED,
+    DIST_EQUAL,
+    DIST_FEW_UNIQUE,
+    DIST_SAWTOOTH,
+    DIST_ORGAN_PIPE,
+    DIST_NEARLY_SORTED,
+    DIST_MEDIAN3_KILLER,
+    DIST_RUNS,
+    DIST_COUNT
+};
+
+static size_t key_bytes = 4;
+
+static uint64_t splitmix64(uint64_t *state) 
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint32_t load_key(const void *element) 
+{
+    uint32_t key = 0;
+    memcpy(&key, element, key_bytes);
+    return key;
+}
+
+static int cmp_key(const void *a, const void *b) 
+{
+    uint32_t ka = load_key(a);
+    uint32_t kb = load_key(b);
+    return (ka > kb) - (ka < kb);
+}
+
+// reduce adds up the first payload byte, so the folded values are checked too
+static void combine_payload(void *accumulator, const void *element) 
+{
+    unsigned char *acc = (unsigned char *)accumulator + key_bytes;
+    const unsigned char *elem = (const unsigned char *)element + key_bytes;
+    acc[0] = (unsigned char)(acc[0] + elem[0]);
+}
+
+static void fill_payload(unsigned char *element, size_t size_of_element, size_t index) 
+{
+    for (size_t j = key_bytes; j < size_of_element; j++) 
+    {
+        element[j] = (unsigned char)((index >> (8 * (j % sizeof(uint32_t)))) + j);
+    }
+}
+
+static uint32_t generate_key(int dist, size_t i, size_t n, uint32_t param, uint64_t *state) 
+{
+    switch (dist) 
+    {
+        case DIST_RANDOM:
+            return (uint32_t)(splitmix64(state) % (param + 1ull));
+        case DIST_SORTED:
+            return (uint32_t)i;
+        case DIST_REVERSED:
+            return (uint32_t)(n - i);
+        case DIST_EQUAL:
+            return param;
+        case DIST_FEW_UNIQUE:
+            return (uint32_t)(splitmix64(state) % (param % 8 + 2));
+        case DIST_SAWTOOTH:
+            return (uint32_t)(i % (param + 1));
+        case DIST_ORGAN_PIPE:
+            return (uint32_t)(i < n / 2 ? i : n - i);
+        case DIST_NEARLY_SORTED:
+            return splitmix64(state) % 100 == 0 ? (uint32_t)splitmix64(state) : (uint32_t)i;
+        case DIST_MEDIAN3_KILLER:
+            // median-of-3 killer style: odd keys rise through the first half, even keys through the second
+            if (i < n / 2) 
+            {
+                return (uint32_t)(i % 2 == 0 ? i + 1 : n / 2 + i);
+            }
+            return (uint32_t)((i - n / 2 + 1) * 2);
+        case DIST_RUNS:
+            return (uint32_t)(i % (param * 16 + 17) + (i / (param * 16 + 17)) % 3);
+        default:
+            return 0;
+    }
+}
+
+static void report_failure(const uint8_t *data, size_t size, const char *what, size_t size_of_element, size_t n, size_t at) 
+{
+    fprintf(stderr, "ERROR: fuzz – %s, element size %zu, n=%zu, first difference at %zu, input saved to " FUZZ_CRASH_FILE "\n",
+            what, size_of_element, n, at);
+    FILE *file = fopen(FUZZ_CRASH_FILE, "wb");
+    if (file) 
+    {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+    abort();
+}
+
+static void check_equal(const uint8_t *data, size_t size, const char *what, const unsigned char *actual,
+                        const unsigned char *expected, size_t size_of_element, size_t n) 
+{
+    if (n == 0 || memcmp(actual, expected, n * size_of_element) == 0) 
+    {
+        return;
+    }
+    size_t at = 0;
+    while (memcmp(actual + at * size_of_element, expected + at * size_of_element, size_of_element) == 0) 
+    {
+        at++;
+    }
+    report_failure(data, size, what, size_of_element, n, at);
+}
+
+// reference permutation: std::stable_sort over element indices
+static std::vector<size_t> stable_order(const unsigned char *array, size_t n, size_t size_of_element) 
+{
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++) 
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) 
+    {
+        return cmp_key(array + a * size_of_element, array + b * size_of_element) < 0;
+    });
+    return order;
+}
+
+// reference: stable order, then gather
+static std::vector<unsigned char> stable_reference(const unsigned char *array, size_t n, size_t size_of_element) 
+{
+    std::vector<size_t> order = stable_order(array, n, size_of_element);
+    std::vector<unsigned char> sorted(n * size_of_element);
+    for (size_t i = 0; i < n; i++) 
+    {
+        memcpy(&sorted[i * size_of_element], array + order[i] * size_of_element, size_of_element);
+    }
+    return sorted;
+}
+
+// reference for unique / reduce: linear pass over the stable reference
+static size_t collapse_reference(std::vector<unsigned char> &sorted, size_t n, size_t size_of_element, bool reduce) 
+{
+    unsigned char *base = sorted.data();
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) 
+    {
+        unsigned char *elem = base + i * size_of_element;
+        if (kept > 0 && cmp_key(base + (kept - 1) * size_of_element, elem) == 0) 
+        {
+            if (reduce) 
+            {
+                combine_payload(base + (kept - 1) * size_of_element, elem);
+            }
+        }
+        else 
+        {
+            memmove(base + kept * size_of_element, elem, size_of_element);
+            kept++;
+        }
+    }
+    return kept;
+}
+
+// bytes of the second fuzzed column, derived from the record index like the element payload
+static void fill_column(unsigned char *value, size_t size_of_value, size_t index) 
+{
+    for (size_t j = 0; j < size_of_value; j++) 
+    {
+        value[j] = (unsigned char)((index >> (8 * (j % sizeof(uint32_t)))) ^ (j * 31));
+    }
+}
+
+static void count_job(void *array, size_t size_of_array, void *user_data) 
+{
+    (void)array;
+    (void)size_of_array;
+    __atomic_fetch_add((size_t *)user_data, 1, __ATOMIC_RELAXED);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) 
+{
+    if (size < FUZZ_HEADER_SIZE) 
+    {
+        return 0;
+    }
+
+    const size_t size_of_element = ELEMENT_SIZES[data[0] % ELEMENT_SIZE_COUNT];
+    const int op = data[1] % OP_COUNT;
+    const int dist = data[2] % DIST_COUNT;
+    const uint32_t param = data[6];
+    uint64_t state = 0;
+    memcpy(&state, data + 7, sizeof(state));
+    key_bytes = size_of_element < sizeof(uint32_t) ? size_of_element : sizeof(uint32_t);
+
+    size_t n = (size_t)data[3] | (size_t)data[4] << 8 | (size_t)data[5] << 16;
+    if (dist == DIST_RAW) 
+    {
+        n = (size - FUZZ_HEADER_SIZE) / key_bytes;
+    }
+    n = std::min(n, std::min((size_t)FUZZ_MAX_SIZE, (size_t)FUZZ_MAX_BYTES / size_of_element));
+
+    std::vector<unsigned char> input(n * size_of_element + 1);
+    unsigned char *array = input.data();
+    const uint32_t key_mask = key_bytes == sizeof(uint32_t) ? UINT32_MAX : (1u << (8 * key_bytes)) - 1;
+    for (size_t i = 0; i < n; i++) 
+    {
+        unsigned char *elem = array + i * size_of_element;
+        if (dist == DIST_RAW) 
+        {
+            memcpy(elem, data + FUZZ_HEADER_SIZE + i * key_bytes, key_bytes);
+        }
+        else 
+        {
+            uint32_t key = generate_key(dist, i, n, param, &state) & key_mask;
+            memcpy(elem, &key, key_bytes);
+        }
+        fill_payload(elem, size_of_element, i);
+    }
+
+    // append: the prefix arrives already sorted, merge: both runs do
+    size_t sorted_size = n * param / 255;
+    if (op == OP_APPEND || op == OP_MERGE) 
+    {
+        std::vector<unsigned char> prefix = stable_reference(array, sorted_size, size_of_element);
+        if (sorted_size > 0) 
+        {
+            memcpy(array, prefix.data(), prefix.size());
+        }
+    }
+    if (op == OP_MERGE && sorted_size < n) 
+    {
+        unsigned char *tail = array + sorted_size * size_of_element;
+        std::vector<unsigned char> run = stable_reference(tail, n - sorted_size, size_of_element);
+        memcpy(tail, run.data(), run.size());
+    }
+
+    std::vector<unsigned char> expected = stable_reference(array, n, size_of_element);
+    std::vector<unsigned char> actual(n * size_of_element + 1);
+
+    switch (op) 
+    {
+        case OP_SORT:
+            logsort(array, n, size_of_element, cmp_key);
+            check_equal(data, size, "logsort", array, expected.data(), size_of_element, n);
+            break;
+        case OP_RECURSIVE: 
+        {
+            // exactly the documented (n + 1) elements, so an overrun is caught by ASan
+            unsigned char *buffer = (unsigned char *)malloc((n + 1) * size_of_element);
+            if (!buffer) 
+            {
+                return 0;
+            }
+            logsort_recursive(array, n, size_of_element, cmp_key, buffer);
+            free(buffer);
+            check_equal(data, size, "logsort_recursive", array, expected.data(), size_of_element, n);
+            break;
+        }
+        case OP_APPEND:
+            logsort_append(array, sorted_size, n, size_of_element, cmp_key);
+            check_equal(data, size, "logsort_append", array, expected.data(), size_of_element, n);
+            break;
+        case OP_UNIQUE:
+        case OP_REDUCE: 
+        {
+            // reduce needs a payload byte to fold into
+            bool reduce = op == OP_REDUCE && size_of_element > key_bytes;
+            size_t kept = reduce ? logsort_reduce(array, n, size_of_element, cmp_key, combine_payload)
+                                 : logsort_unique(array, n, size_of_element, cmp_key);
+            size_t expected_kept = collapse_reference(expected, n, size_of_element, reduce);
+            if (kept != expected_kept) 
+            {
+                report_failure(data, size, reduce ? "logsort_reduce length" : "logsort_unique length",
+                               size_of_element, n, kept);
+            }
+            check_equal(data, size, reduce ? "logsort_reduce" : "logsort_unique", array, expected.data(),
+                        size_of_element, kept);
+            break;
+        }
+        case OP_STREAM: 
+        {
+            LogsortStream stream;
+            if (logsort_stream_init(&stream, size_of_element, cmp_key) != 0) 
+            {
+                return 0;
+            }
+            size_t batch = param + 1;
+            for (size_t pushed = 0; pushed < n; pushed += batch) 
+            {
+                if (logsort_stream_push(&stream, array + pushed * size_of_element, std::min(batch, n - pushed)) != 0) 
+                {
+                    logsort_stream_destroy(&stream);
+                    return 0;
+                }
+            }
+            size_t emitted = 0;
+            for (const void *elem = logsort_stream_next(&stream, NULL); elem && emitted < n;
+                 elem = logsort_stream_next(&stream, NULL)) 
+            {
+                memcpy(actual.data() + emitted * size_of_element, elem, size_of_element);
+                emitted++;
+            }
+            logsort_stream_destroy(&stream);
+            if (emitted != n) 
+            {
+                report_failure(data, size, "logsort_stream count", size_of_element, n, emitted);
+            }
+            check_equal(data, size, "logsort_stream", actual.data(), expected.data(), size_of_element, n);
+            break;
+        }
+        case OP_STREAM_WATERMARK: 
+        {
+            // after every batch the watermark is the smallest element still to come
+            std::vector<size_t> suffix_min(n + 1, n);
+            for (size_t i = n; i-- > 0;) 
+            {
+                size_t next = suffix_min[i + 1];
+                suffix_min[i] = next < n && cmp_key(array + next * size_of_element, array + i * size_of_element) <= 0 ? next : i;
+            }
+            LogsortStream stream;
+            if (logsort_stream_init(&stream, size_of_element, cmp_key) != 0) 
+            {
+                return 0;
+            }
+            size_t batch = param + 1;
+            size_t emitted = 0;
+            for (size_t pushed = 0; pushed < n;) 
+            {
+                size_t count = std::min(batch, n - pushed);
+                if (logsort_stream_push(&stream, array + pushed * size_of_element, count) != 0) 
+                {
+                    logsort_stream_destroy(&stream);
+                    return 0;
+                }
+                pushed += count;
+                const void *watermark = pushed < n ? array + suffix_min[pushed] * size_of_element : NULL;
+                for (const void *elem = logsort_stream_next(&stream, watermark); elem && emitted < n;
+                     elem = logsort_stream_next(&stream, watermark)) 
+                {
+                    if (watermark && cmp_key(elem, watermark) > 0) 
+                    {
+                        report_failure(data, size, "logsort_stream element above the watermark", size_of_element, n, emitted);
+                    }
+                    memcpy(actual.data() + emitted * size_of_element, elem, size_of_element);
+                    emitted++;
+                }
+            }
+            logsort_stream_destroy(&stream);
+            if (emitted != n) 
+            {
+                report_failure(data, size, "logsort_stream watermark count", size_of_element, n, emitted);
+            }
+            check_equal(data, size, "logsort_stream watermark", actual.data(), expected.data(), size_of_element, n);
+            break;
+        }
+        case OP_MERGE: 
+        {
+            // exactly the documented n - sorted_size elements of buffer
+            size_t tail = n - sorted_size;
+            unsigned char *buffer = (unsigned char *)malloc(tail ? tail * size_of_element : 1);
+            if (!buffer) 
+            {
+                return 0;
+            }
+            logsort_merge(array, sorted_size, n, size_of_element, cmp_key, buffer);
+            free(buffer);
+            check_equal(data, size, "logsort_merge", array, expected.data(), size_of_element, n);
+            break;
+        }
+        case OP_COLUMNS: 
+        case OP_TAGGED: 
+        {
+            std::vector<size_t> order = stable_order(array, n, size_of_element);
+            std::vector<size_t> index(n + 1);
+            int res = 0;
+            if (op == OP_TAGGED) 
+            {
+                res = logsort_tagged(array, n, size_of_element, cmp_key, index.data());
+            }
+            else 
+            {
+                // an index column and a column of odd width, both gathered with the same permutation
+                size_t column_size = param % 13 + 1;
+                std::vector<unsigned char> column(n * column_size + 1);
+                std::vector<unsigned char> expected_column(n * column_size + 1);
+                for (size_t i = 0; i < n; i++) 
+                {
+                    index[i] = i;
+                    fill_column(&column[i * column_size], column_size, i);
+                    fill_column(&expected_column[i * column_size], column_size, order[i]);
+                }
+                void *columns[] = {index.data(), column.data()};
+                size_t column_sizes[] = {sizeof(size_t), column_size};
+                res = logsort_columns(array, n, size_of_element, cmp_key, columns, column_sizes, 2);
+                if (res == 0) 
+                {
+                    check_equal(data, size, "logsort_columns column", column.data(), expected_column.data(), 
+                                column_size, n);
+                }
+            }
+            if (res != 0) 
+            {
+                return 0;
+            }
+            const char *what = op == OP_TAGGED ? "logsort_tagged" : "logsort_columns";
+            check_equal(data, size, what, array, expected.data(), size_of_element, n);
+            check_equal(data, size, what, (const unsigned char *)index.data(), (const unsigned char *)order.data(), 
+                        sizeof(size_t), n);
+            break;
+        }
+        case OP_EXECUTOR: 
+        {
+            // param % 8 + 1 independent jobs on consecutive slices, every other one waited for
+            LogsortExecutor *executor = logsort_executor_create(param % 3 + 2);
+            if (!executor) 
+            {
+                return 0;
+            }
+            size_t jobs = param % 8 + 1;
+            size_t done = 0;
+            std::vector<size_t> bounds(jobs + 1);
+            for (size_t j = 0; j <= jobs; j++) 
+            {
+                bounds[j] = n * j / jobs;
+            }
+            for (size_t j = 0; j < jobs; j++) 
+            {
+                unsigned char *slice = array + bounds[j] * size_of_element;
+                size_t count = bounds[j + 1] - bounds[j];
+                std::vector<unsigned char> run = stable_reference(slice, count, size_of_element);
+                if (count > 0) 
+                {
+                    memcpy(expected.data() + bounds[j] * size_of_element, run.data(), run.size());
+                }
+                LogsortJob *job = logsort_executor_submit(executor, slice, count, size_of_element, cmp_key, 
+                                                          count_job, &done);
+                if (!job) 
+                {
+                    report_failure(data, size, "logsort_executor_submit", size_of_element, n, bounds[j]);
+                }
+                if (j % 2) 
+                {
+                    logsort_job_wait(job);
+                }
+                else 
+                {
+                    logsort_job_release(job);
+                }
+            }
+            logsort_executor_destroy(executor);
+            if (__atomic_load_n(&done, __ATOMIC_RELAXED) != jobs) 
+            {
+                report_failure(data, size, "logsort_executor callbacks", size_of_element, n, done);
+            }
+            check_equal(data, size, "logsort_executor", array, expected.data(), size_of_element, n);
+            break;
+        }
+        default:
+            break;
+    }
+    return 0;
+}
+
+#ifndef LOGSORT_LIBFUZZER
+
+static int replay_file(const char *path) 
+{
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!file) 
+    {
+        perror(path);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t got = 0;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) 
+    {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    if (file != stdin) 
+    {
+        fclose(file);
+    }
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    return 0;
+}
+
+// property mode: random headers over all sizes / operations / distributions, log-uniform element counts
+static void run_properties(size_t iterations, uint64_t seed) 
+{
+    std::vector<uint8_t> data;
+    for (size_t iter = 0; iter < iterations; iter++) 
+    {
+        uint64_t state = seed + iter;
+        uint64_t bits = splitmix64(&state);
+        size_t n = splitmix64(&state) % (1u << (bits % 19));
+
+        data.assign(FUZZ_HEADER_SIZE, 0);
+        data[0] = (uint8_t)(bits >> 8);
+        data[1] = (uint8_t)(bits >> 16);
+        data[2] = (uint8_t)(bits >> 24);
+        data[3] = (uint8_t)n;
+        data[4] = (uint8_t)(n >> 8);
+        data[5] = (uint8_t)(n >> 16);
+        data[6] = (uint8_t)(bits >> 32);
+        uint64_t gen_seed = splitmix64(&state);
+        memcpy(&data[7], &gen_seed, sizeof(gen_seed));
+        if (data[2] % DIST_COUNT == DIST_RAW) 
+        {
+            for (size_t i = 0; i < n % 4096 * 4; i++) 
+            {
+                data.push_back((uint8_t)(splitmix64(&state) % (bits % 2 == 0 ? 4 : 256)));
+            }
+        }
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+}
+
+int main(int argc, char **argv) 
+{
+    if (argc > 1 && (argv[1][0] < '0' || argv[1][0] > '9')) 
+    {
+        for (int i = 1; i < argc; i++) 
+        {
+            if (replay_file(argv[i]) != 0) 
+            {
+                return 1;
+            }
+        }
+        printf("Replayed %d inputs\n", argc - 1);
+        return 0;
+    }
+
+    size_t iterations = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 1000;
+    uint64_t seed = argc > 2 ? (uint64_t)strtoull(argv[2], NULL, 10) : 1;
+    printf("fuzz seed = %llu, iterations = %zu\n", (unsigned long long)seed, iterations);
+    run_properties(iterations, seed);
+    printf("Property tests passed\n");
+    return 0;
+}
+
+#endif
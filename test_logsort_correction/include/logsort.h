@@ -2,6 +2,10 @@
 #define LOGSORT_H
 #include <stdio.h>
 
+#include "logsort_api.h"
+
+LOGSORT_BEGIN_DECLS
+
 typedef int (*cmp_func_t)(const void *a, const void *b);
 
 //intersection sort for small arrays
@@ -17,4 +21,45 @@ void logsort_recursive(void *array, size_t size_of_array, size_t size_of_element
 // general function of logsort
 void logsort(void *array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp);
 
+// folds element into accumulator, both compare equal; called in the original order of the elements
+typedef void (*combine_func_t)(void *accumulator, const void *element);
+
+// sort + duplicate elimination in one pass: every run of equal elements is collapsed to its first element
+// as soon as a partition isolates it, return the new length
+size_t logsort_unique(void *array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp);
+// like logsort_unique, but later equal elements are folded into the first one with combine (group-by)
+size_t logsort_reduce(void *array, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, combine_func_t combine);
+
+// incremental sort: array[0, sorted_size) is already sorted, array[sorted_size, size_of_array) is a new tail
+// sorts only the tail and stably merges it into the prefix: O(m log m + n) for a tail of m elements
+void logsort_append(void *array, size_t sorted_size, size_t size_of_array, size_t size_of_element, cmp_func_t cmp);
+
+// stable merge of two sorted runs array[0, sorted_size) and array[sorted_size, size_of_array)
+// buffer holds at least size_of_array - sorted_size elements
+void logsort_merge(void *array, size_t sorted_size, size_t size_of_array, size_t size_of_element, cmp_func_t cmp, void *buffer);
+
+// streaming sort: batches are pushed as they arrive, sorted elements are read back one by one
+typedef struct
+{
+    char *data;
+    size_t capacity;
+    size_t size_of_element;
+    size_t emitted; // elements already returned by logsort_stream_next
+    size_t sorted;  // data[0, sorted) is in sorted order
+    size_t count;   // elements stored in data
+    cmp_func_t cmp;
+} LogsortStream;
+
+// return 0 on success, -1 on error
+int logsort_stream_init(LogsortStream *stream, size_t size_of_element, cmp_func_t cmp);
+// copies count elements into the stream, pointers returned by logsort_stream_next become invalid
+int logsort_stream_push(LogsortStream *stream, const void *elements, size_t count);
+// next element in sorted order or NULL
+// watermark: every element pushed later compares >= watermark, so elements <= watermark are final
+// watermark == NULL: input is finished, the whole rest is emitted
+const void *logsort_stream_next(LogsortStream *stream, const void *watermark);
+void logsort_stream_destroy(LogsortStream *stream);
+
+LOGSORT_END_DECLS
+
 #endif
\ No newline at end of file
@@ -0,0 +1,19 @@
+#ifndef LOGSORT_COLUMNS_H
+#define LOGSORT_COLUMNS_H
+#include <stdio.h>
+
+#include "logsort.h"
+#include "logsort_api.h"
+
+LOGSORT_BEGIN_DECLS
+
+// stable sort of parallel arrays (struct-of-arrays): keys[i] and columns[c][i] form one record
+// cmp compares two keys, column_sizes[c] is the element size of columns[c]
+// the permutation is built once from the keys and then applied column by column
+// return 0 on success, -1 on error (arrays are left unchanged)
+int logsort_columns(void *keys, size_t size_of_array, size_t size_of_key, cmp_func_t cmp, 
+                    void **columns, const size_t *column_sizes, size_t column_count);
+
+LOGSORT_END_DECLS
+
+#endif
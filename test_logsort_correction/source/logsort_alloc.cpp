@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "logsort_alloc.h"
+
+#define HUGE_PAGE_SIZE LOGSORT_ALLOC_MIN_BYTES
+#define MPOL_INTERLEAVE_MODE 3 // MPOL_INTERLEAVE from <numaif.h>, without linking libnuma
+#define NODE_MASK_WORDS 16     // node mask for up to 1024 NUMA nodes
+
+static std::atomic<unsigned> scratch_flags(LOGSORT_ALLOC_DEFAULT);
+static std::atomic<size_t> scratch_touch_threads(1);
+
+static size_t round_up(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+#ifdef __linux__
+// thread t pins itself to the t-th CPU the process may run on before its first write,
+// so its slice is placed on the node of that CPU
+// never throws: without memory nothing is pinned, a slice whose thread cannot be started is touched here
+static void touch_pages(char* data, size_t size, size_t touch_threads)
+{
+    size_t page = 4096;
+    size_t pages = (size + page - 1) / page;
+    if (touch_threads > pages) 
+    {
+        touch_threads = pages;
+    }
+    
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    std::vector<size_t> cpus;
+    std::vector<std::thread> threads;
+    try 
+    {
+        threads.reserve(touch_threads);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) 
+        {
+            for (size_t cpu = 0; cpu < CPU_SETSIZE; cpu++) 
+            {
+                if (CPU_ISSET(cpu, &allowed)) 
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+    } 
+    catch (...) 
+    {
+        cpus.clear();
+        touch_threads = 1;
+    }
+    
+    size_t chunk = (pages + touch_threads - 1) / touch_threads;
+    for (size_t t = 0; t < touch_threads; t++) 
+    {
+        size_t begin = t * chunk;
+        size_t end = begin + chunk < pages ? begin + chunk : pages;
+        bool pin = !cpus.empty();
+        size_t cpu = pin ? cpus[t % cpus.size()] : 0;
+        auto touch = [data, page, begin, end, pin, cpu]() 
+        {
+            if (pin) 
+            {
+                // a failed pin only costs placement, the pages are touched either way
+                cpu_set_t target;
+                CPU_ZERO(&target);
+                CPU_SET(cpu, &target);
+                pthread_setaffinity_np(pthread_self(), sizeof(target), &target);
+            }
+            for (size_t p = begin; p < end; p++) 
+            {
+                data[p * page] = 0;
+            }
+        };
+        try 
+        {
+            threads.emplace_back(touch);
+        } 
+        catch (...) 
+        {
+            // touched here without pinning, the calling thread keeps its affinity
+            for (size_t p = begin; p < end; p++) 
+            {
+                data[p * page] = 0;
+            }
+        }
+    }
+    for (std::thread& th : threads) 
+    {
+        th.join();
+    }
+}
+
+// mask of the nodes that have memory, parsed from a list like "0-1,3"; node 0 alone if the list is missing
+// return the highest node + 1
+static size_t memory_nodes(unsigned long* mask)
+{
+    const size_t word_bits = sizeof(unsigned long) * 8;
+    memset(mask, 0, NODE_MASK_WORDS * sizeof(unsigned long));
+    size_t nodes = 0;
+    
+    FILE* file = fopen("/sys/devices/system/node/has_memory", "r");
+    if (file) 
+    {
+        unsigned long first = 0;
+        unsigned long last = 0;
+        int sep = 0;
+        while (fscanf(file, "%lu", &first) == 1) 
+        {
+            last = first;
+            sep = fgetc(file);
+            if (sep == '-') 
+            {
+                if (fscanf(file, "%lu", &last) != 1) 
+                {
+                    break;
+                }
+                sep = fgetc(file);
+            }
+            for (unsigned long node = first; node <= last && node < NODE_MASK_WORDS * word_bits; node++) 
+            {
+                mask[node / word_bits] |= 1ul << (node % word_bits);
+                nodes = node + 1 > nodes ? node + 1 : nodes;
+            }
+            if (sep != ',') 
+            {
+                break;
+            }
+        }
+        fclose(file);
+    }
+    
+    if (nodes == 0) 
+    {
+        mask[0] = 1;
+        nodes = 1;
+    }
+    return nodes;
+}
+#endif
+
+int logsort_buffer_alloc(LogsortBuffer* buffer, size_t size, unsigned flags, size_t touch_threads) 
+{
+    if (!buffer || size == 0) 
+    {
+        return -1;
+    }
+    
+    buffer->data = NULL;
+    buffer->size = size;
+    buffer->mapped = 0;
+    
+#ifdef __linux__
+    // a mapping costs syscalls (and threads for first touch) on every call, small buffers go to calloc
+    if ((flags != LOGSORT_ALLOC_DEFAULT || touch_threads > 1) && size >= LOGSORT_ALLOC_MIN_BYTES) 
+    {
+        void* data = MAP_FAILED;
+        size_t mapped = 0;
+        
+        if (flags & LOGSORT_ALLOC_HUGETLB) 
+        {
+            mapped = round_up(size, HUGE_PAGE_SIZE);
+            data = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        
+        if (data == MAP_FAILED) 
+        {
+            int huge = (flags & (LOGSORT_ALLOC_HUGEPAGE | LOGSORT_ALLOC_HUGETLB)) != 0;
+            mapped = round_up(size, huge ? HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE));
+            data = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (data == MAP_FAILED) 
+            {
+                return -1;
+            }
+            if (huge) 
+            {
+                madvise(data, mapped, MADV_HUGEPAGE);
+            }
+        }
+        
+        if (flags & LOGSORT_ALLOC_INTERLEAVE) 
+        {
+            // only nodes with memory: a mask wider than the kernel's MAX_NUMNODES is rejected with EINVAL
+            // maxnode counts one bit more than the kernel reads
+            unsigned long nodemask[NODE_MASK_WORDS];
+            size_t nodes = memory_nodes(nodemask);
+            if (syscall(SYS_mbind, data, mapped, MPOL_INTERLEAVE_MODE, nodemask, nodes + 1, 0) != 0) 
+            {
+                int err = errno;
+                munmap(data, mapped);
+                errno = err;
+                return -1;
+            }
+        }
+        
+        if (touch_threads > 1) 
+        {
+            touch_pages((char*)data, mapped, touch_threads);
+        }
+        
+        buffer->data = data;
+        buffer->mapped = mapped;
+        return 0;
+    }
+#else
+    (void)flags;
+    (void)touch_threads;
+#endif
+    
+    buffer->data = calloc(size, sizeof(char));
+    return buffer->data ? 0 : -1;
+}
+
+void logsort_buffer_free(LogsortBuffer* buffer) 
+{
+    if (!buffer || !buffer->data) 
+    {
+        return;
+    }
+    
+#ifdef __linux__
+    if (buffer->mapped) 
+    {
+        munmap(buffer->data, buffer->mapped);
+    } 
+    else 
+    {
+        free(buffer->data);
+    }
+#else
+    free(buffer->data);
+#endif
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->mapped = 0;
+}
+
+void logsort_set_scratch_policy(unsigned flags, size_t touch_threads) 
+{
+    scratch_flags.store(flags, std::memory_order_relaxed);
+    scratch_touch_threads.store(touch_threads, std::memory_order_relaxed);
+}
+
+void logsort_get_scratch_policy(unsigned* flags, size_t* touch_threads) 
+{
+    if (flags) 
+    {
+        *flags = scratch_flags.load(std::memory_order_relaxed);
+    }
+    if (touch_threads) 
+    {
+        *touch_threads = scratch_touch_threads.load(std::memory_order_relaxed);
+    }
+}
+
+int logsort_parse_alloc_policy(const char* name, unsigned* flags) 
+{
+    if (!name || !flags) 
+    {
+        return -1;
+    }
+    
+    unsigned result = LOGSORT_ALLOC_DEFAULT;
+    const char* p = name;
+    while (*p) 
+    {
+        const char* end = strchr(p, '+');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        
+        if (len == 7 && strncmp(p, "default", len) == 0) 
+        {
+            result |= LOGSORT_ALLOC_DEFAULT;
+        } 
+        else if (len == 3 && strncmp(p, "thp", len) == 0) 
+        {
+            result |= LOGSORT_ALLOC_HUGEPAGE;
+        } 
+        else if (len == 7 && strncmp(p, "hugetlb", len) == 0) 
+        {
+            result |= LOGSORT_ALLOC_HUGETLB;
+        } 
+        else if (len == 10 && strncmp(p, "interleave", len) == 0) 
+        {
+            result |= LOGSORT_ALLOC_INTERLEAVE;
+        } 
+        else 
+        {
+            return -1;
+        }
+        
+        p += len;
+        if (*p == '+') 
+        {
+            p++;
+        }
+    }
+    
+    *flags = result;
+    return 0;
+}
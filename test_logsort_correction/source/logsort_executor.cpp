@@ -0,0 +1,505 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "logsort_executor.h"
+
+#define MAX_SPLIT_CHUNKS 64
+
+struct LogsortJob
+{
+    void* array;
+    size_t n;
+    size_t elem_size;
+    cmp_func_t cmp;
+    logsort_done_func_t done;
+    void* user_data;
+    std::atomic<int> refs;           // handle + executor, user jobs only
+    std::atomic<size_t>* pending;    // chunk of a split job: counter of the parent, NULL for user jobs
+    bool finished;
+    std::mutex mutex;
+    std::condition_variable cv;
+    
+    LogsortJob(void* arr, size_t size, size_t es, cmp_func_t compare) : 
+        array(arr), n(size), elem_size(es), cmp(compare), done(NULL), user_data(NULL), 
+        refs(2), pending(NULL), finished(false), mutex(), cv() {}
+    LogsortJob(const LogsortJob&) = delete;
+    LogsortJob& operator=(const LogsortJob&) = delete;
+};
+
+struct QueueCell
+{
+    std::atomic<size_t> sequence;
+    LogsortJob* job;
+};
+
+// bounded lock-free MPMC queue (Vyukov): a cell is free for position pos when sequence == pos
+// and holds a job for position pos when sequence == pos + 1
+class JobQueue final
+{
+public:
+    JobQueue() : cells(new QueueCell[LOGSORT_EXECUTOR_QUEUE_SIZE]), enqueue_pos(0), dequeue_pos(0) 
+    {
+        for (size_t i = 0; i < LOGSORT_EXECUTOR_QUEUE_SIZE; i++) 
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+            cells[i].job = NULL;
+        }
+    }
+    
+    bool push(LogsortJob* job) 
+    {
+        QueueCell* cell = NULL;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) 
+        {
+            cell = &cells[pos & (LOGSORT_EXECUTOR_QUEUE_SIZE - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) 
+            {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) 
+                {
+                    break;
+                }
+            } 
+            else if (diff < 0) 
+            {
+                return false;
+            } 
+            else 
+            {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->job = job;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    
+    LogsortJob* pop() 
+    {
+        QueueCell* cell = NULL;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) 
+        {
+            cell = &cells[pos & (LOGSORT_EXECUTOR_QUEUE_SIZE - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) 
+            {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) 
+                {
+                    break;
+                }
+            } 
+            else if (diff < 0) 
+            {
+                return NULL;
+            } 
+            else 
+            {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        LogsortJob* job = cell->job;
+        cell->sequence.store(pos + LOGSORT_EXECUTOR_QUEUE_SIZE, std::memory_order_release);
+        return job;
+    }
+    
+private:
+    std::unique_ptr<QueueCell[]> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
+};
+
+static_assert((LOGSORT_EXECUTOR_QUEUE_SIZE & (LOGSORT_EXECUTOR_QUEUE_SIZE - 1)) == 0, 
+              "queue size must be a power of two");
+
+// the mutex only guards sleeping: producers take it (and notify) only when a worker sleeps and is needed
+// sleepers / queued / batching are seq_cst, so a worker that announces itself as a sleeper and then
+// finds queued == 0 cannot miss a producer that bumped queued and then saw no sleepers
+struct LogsortExecutor
+{
+    JobQueue queue;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<size_t> queued;
+    std::atomic<size_t> sleepers;
+    std::atomic<size_t> batching; // workers running a batch of small jobs
+    bool stopping;
+    
+    LogsortExecutor() : queue(), workers(), mutex(), cv(), queued(0), sleepers(0), batching(0), stopping(false) {}
+};
+
+// scratch buffer owned by one worker, grows with its jobs and is kept up to LOGSORT_EXECUTOR_SCRATCH_KEEP
+typedef struct 
+{
+    char* data;
+    size_t size;
+} WorkerScratch;
+
+static void trim_scratch(WorkerScratch* scratch)
+{
+    if (scratch->size > LOGSORT_EXECUTOR_SCRATCH_KEEP) 
+    {
+        free(scratch->data);
+        scratch->data = NULL;
+        scratch->size = 0;
+    }
+}
+
+static char* reserve_scratch(WorkerScratch* scratch, size_t size)
+{
+    if (scratch->size < size) 
+    {
+        char* tmp = (char*)realloc(scratch->data, size);
+        if (!tmp) 
+        {
+            return NULL;
+        }
+        scratch->data = tmp;
+        scratch->size = size;
+    }
+    return scratch->data;
+}
+
+static bool is_small(const LogsortJob* job)
+{
+    return job->n * job->elem_size < LOGSORT_EXECUTOR_SMALL_BYTES;
+}
+
+// lock-free unless a sleeping worker has to be woken
+// a small job wakes nobody while a batching worker has fewer than LOGSORT_EXECUTOR_BATCH jobs queued per head,
+// so bursts of tiny sorts stay on the worker that is already draining them
+static bool enqueue(LogsortExecutor* executor, LogsortJob* job)
+{
+    if (!executor->queue.push(job)) 
+    {
+        return false;
+    }
+    size_t queued = executor->queued.fetch_add(1) + 1;
+    if (executor->sleepers.load() == 0) 
+    {
+        return true;
+    }
+    size_t batching = executor->batching.load();
+    if (is_small(job) && batching > 0 && queued <= batching * LOGSORT_EXECUTOR_BATCH) 
+    {
+        return true;
+    }
+    {
+        // empty critical section: a worker between its predicate check and the wait holds the mutex
+        std::lock_guard<std::mutex> lock(executor->mutex);
+    }
+    executor->cv.notify_one();
+    return true;
+}
+
+static LogsortJob* dequeue(LogsortExecutor* executor)
+{
+    LogsortJob* job = executor->queue.pop();
+    if (job) 
+    {
+        executor->queued.fetch_sub(1);
+    }
+    return job;
+}
+
+static void release_job(LogsortJob* job)
+{
+    if (job->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) 
+    {
+        delete job;
+    }
+}
+
+static void run_job(LogsortExecutor* executor, LogsortJob* job, WorkerScratch* scratch);
+
+// huge job: chunks are sorted by all workers, this worker helps until they are done and merges them
+static void split_job(LogsortExecutor* executor, LogsortJob* job, WorkerScratch* scratch)
+{
+    size_t chunks = executor->workers.size();
+    if (chunks > MAX_SPLIT_CHUNKS) 
+    {
+        chunks = MAX_SPLIT_CHUNKS;
+    }
+    
+    char* array = (char*)job->array;
+    size_t elem_size = job->elem_size;
+    size_t bounds[MAX_SPLIT_CHUNKS + 1];
+    for (size_t c = 0; c <= chunks; c++) 
+    {
+        bounds[c] = job->n * c / chunks;
+    }
+    
+    std::atomic<size_t> pending(chunks);
+    std::unique_ptr<LogsortJob> parts[MAX_SPLIT_CHUNKS];
+    for (size_t c = 1; c < chunks; c++) 
+    {
+        // a worker must not throw: a chunk that gets no job object is sorted right here
+        LogsortJob* part = new (std::nothrow) LogsortJob(array + bounds[c] * elem_size, bounds[c + 1] - bounds[c], 
+                                                         elem_size, job->cmp);
+        if (!part) 
+        {
+            LogsortJob local(array + bounds[c] * elem_size, bounds[c + 1] - bounds[c], elem_size, job->cmp);
+            local.pending = &pending;
+            run_job(executor, &local, scratch);
+            continue;
+        }
+        parts[c].reset(part);
+        part->pending = &pending;
+        if (!enqueue(executor, part)) 
+        {
+            run_job(executor, part, scratch);
+        }
+    }
+    
+    LogsortJob first(array, bounds[1], elem_size, job->cmp);
+    first.pending = &pending;
+    run_job(executor, &first, scratch);
+    
+    while (pending.load(std::memory_order_acquire) > 0) 
+    {
+        LogsortJob* other = dequeue(executor);
+        if (other) 
+        {
+            run_job(executor, other, scratch);
+        } 
+        else 
+        {
+            std::this_thread::yield();
+        }
+    }
+    
+    char* buffer = reserve_scratch(scratch, (job->n + 1) * elem_size);
+    for (size_t step = 1; step < chunks; step *= 2) 
+    {
+        for (size_t c = 0; c + step < chunks; c += 2 * step) 
+        {
+            size_t lo = bounds[c];
+            size_t mid = bounds[c + step];
+            size_t hi = bounds[c + 2 * step < chunks ? c + 2 * step : chunks];
+            if (buffer) 
+            {
+                logsort_merge(array + lo * elem_size, mid - lo, hi - lo, elem_size, job->cmp, buffer);
+            } 
+            else 
+            {
+                logsort_append(array + lo * elem_size, mid - lo, hi - lo, elem_size, job->cmp);
+            }
+        }
+    }
+}
+
+static void run_job(LogsortExecutor* executor, LogsortJob* job, WorkerScratch* scratch)
+{
+    size_t bytes = job->n * job->elem_size;
+    if (!job->pending && bytes >= LOGSORT_EXECUTOR_SPLIT_BYTES && executor->workers.size() > 1) 
+    {
+        split_job(executor, job, scratch);
+    } 
+    else 
+    {
+        char* buffer = reserve_scratch(scratch, (job->n + 1) * job->elem_size);
+        if (buffer) 
+        {
+            logsort_recursive(job->array, job->n, job->elem_size, job->cmp, buffer);
+        } 
+        else 
+        {
+            logsort(job->array, job->n, job->elem_size, job->cmp);
+        }
+    }
+    
+    if (job->pending) 
+    {
+        job->pending->fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    
+    if (job->done) 
+    {
+        job->done(job->array, job->n, job->user_data);
+    }
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished = true;
+    }
+    job->cv.notify_all();
+    release_job(job);
+}
+
+static void worker_loop(LogsortExecutor* executor)
+{
+    WorkerScratch scratch = {NULL, 0};
+    LogsortJob* batch[LOGSORT_EXECUTOR_BATCH];
+    
+    for (;;) 
+    {
+        LogsortJob* job = dequeue(executor);
+        if (!job) 
+        {
+            std::unique_lock<std::mutex> lock(executor->mutex);
+            executor->sleepers.fetch_add(1);
+            executor->cv.wait(lock, [executor]() 
+            {
+                return executor->queued.load() > 0 || executor->stopping;
+            });
+            executor->sleepers.fetch_sub(1);
+            if (executor->stopping && executor->queued.load() == 0) 
+            {
+                break;
+            }
+            continue;
+        }
+        
+        if (!is_small(job)) 
+        {
+            run_job(executor, job, &scratch);
+            trim_scratch(&scratch);
+            continue;
+        }
+        
+        // small job: claim up to LOGSORT_EXECUTOR_BATCH queued small jobs at once and run them here,
+        // while batching > 0 producers of small jobs do not wake other workers for them
+        executor->batching.fetch_add(1);
+        size_t count = 0;
+        LogsortJob* large = NULL;
+        batch[count++] = job;
+        while (count < LOGSORT_EXECUTOR_BATCH && (job = dequeue(executor)) != NULL) 
+        {
+            if (!is_small(job)) 
+            {
+                large = job;
+                break;
+            }
+            batch[count++] = job;
+        }
+        for (size_t b = 0; b < count; b++) 
+        {
+            run_job(executor, batch[b], &scratch);
+        }
+        executor->batching.fetch_sub(1);
+        if (large) 
+        {
+            run_job(executor, large, &scratch);
+            trim_scratch(&scratch);
+        }
+    }
+    
+    free(scratch.data);
+}
+
+LogsortExecutor* logsort_executor_create(size_t worker_count) 
+{
+    if (worker_count == 0) 
+    {
+        worker_count = std::thread::hardware_concurrency();
+        if (worker_count == 0) 
+        {
+            worker_count = 1;
+        }
+    }
+    
+    // no exception may cross the C interface: out of memory or threads -> NULL
+    LogsortExecutor* executor = NULL;
+    try 
+    {
+        executor = new LogsortExecutor();
+        executor->workers.reserve(worker_count);
+        for (size_t i = 0; i < worker_count; i++) 
+        {
+            executor->workers.emplace_back(worker_loop, executor);
+        }
+    } 
+    catch (...) 
+    {
+        // stops the workers that did start
+        logsort_executor_destroy(executor);
+        return NULL;
+    }
+    return executor;
+}
+
+void logsort_executor_destroy(LogsortExecutor* executor) 
+{
+    if (!executor) 
+    {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(executor->mutex);
+        executor->stopping = true;
+    }
+    executor->cv.notify_all();
+    for (std::thread& th : executor->workers) 
+    {
+        th.join();
+    }
+    delete executor;
+}
+
+LogsortJob* logsort_executor_submit(LogsortExecutor* executor, void* array, size_t size_of_array, 
+                                    size_t size_of_element, cmp_func_t cmp, logsort_done_func_t done, 
+                                    void* user_data) 
+{
+    if (!executor || !cmp || (!array && size_of_array > 0)) 
+    {
+        return NULL;
+    }
+    
+    LogsortJob* job = new (std::nothrow) LogsortJob(array, size_of_array, size_of_element, cmp);
+    if (!job) 
+    {
+        return NULL;
+    }
+    job->done = done;
+    job->user_data = user_data;
+    
+    if (!enqueue(executor, job)) 
+    {
+        // queue full: back pressure, the caller pays for its own sort
+        logsort(array, size_of_array, size_of_element, cmp);
+        if (done) 
+        {
+            done(array, size_of_array, user_data);
+        }
+        job->finished = true;
+        release_job(job);
+    }
+    return job;
+}
+
+void logsort_job_wait(LogsortJob* job) 
+{
+    if (!job) 
+    {
+        return;
+    }
+    
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->cv.wait(lock, [job]() { return job->finished; });
+    }
+    release_job(job);
+}
+
+void logsort_job_release(LogsortJob* job) 
+{
+    if (job) 
+    {
+        release_job(job);
+    }
+}
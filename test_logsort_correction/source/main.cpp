@@ -3,8 +3,13 @@
 #include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <stdint.h>
 
 #include "logsort.h"
+#include "logsort_columns.h"
+#include "logsort_verify.h"
+#include "logsort_alloc.h"
+#include "logsort_executor.h"
 
 int cmp_item(const void *pa, const void *pb);
 int cmp_item_stable(const void *pa, const void *pb);
@@ -156,6 +161,96 @@ static void test_sorted(size_t n)
     free(a);
 }
 
+// Test: sawtooth and organ pipe, median-of-three pivot killers
+static void test_pivot_killers(size_t n) 
+{
+    Item *a = (Item *) calloc(n, sizeof(Item));
+    if (!a) { perror("malloc"); exit(1); }
+
+    for (size_t i = 0; i < n; i++) 
+    {
+        a[i].key = (int)(i % (n / 2));
+        a[i].original_index = (int)i;
+    }
+    logsort(a, n, sizeof(Item), cmp_item);
+    if (!is_sorted_and_stable(a, n)) 
+    {
+        fprintf(stderr, "ERROR: sawtooth input – failed for n=%zu\n", n);
+        exit(1);
+    }
+
+    for (size_t i = 0; i < n; i++) 
+    {
+        a[i].key = (int)(i < n / 2 ? i : n - 1 - i);
+        a[i].original_index = (int)i;
+    }
+    logsort(a, n, sizeof(Item), cmp_item);
+    if (!is_sorted_and_stable(a, n)) 
+    {
+        fprintf(stderr, "ERROR: organ pipe input – failed for n=%zu\n", n);
+        exit(1);
+    }
+    free(a);
+}
+
+// Test: the multi-way step samples fixed positions (i * step + step / 2 of 31 * 8 samples), this input puts the
+// largest remaining keys exactly there on every level, so each level peels off only the sampled elements
+static void test_sample_killer(size_t n) 
+{
+    const size_t sample_size = 31 * 8;
+    const size_t min_size = 4096, min_bytes = 1 << 20;
+
+    Item *a = (Item *) calloc(n, sizeof(Item));
+    size_t *rest = (size_t *) calloc(n, sizeof(size_t));
+    if (!a || !rest) { perror("malloc"); exit(1); }
+
+    // rest = input positions of bucket 0 in stable order, which is the range the next level samples
+    for (size_t i = 0; i < n; i++) 
+    {
+        rest[i] = i;
+    }
+    size_t m = n;
+    int next_key = (int)n;
+    while (m >= min_size && m * sizeof(Item) >= min_bytes) 
+    {
+        size_t step = m / sample_size;
+        for (size_t i = 0; i < sample_size; i++) 
+        {
+            a[rest[i * step + step / 2]].key = next_key--;
+            rest[i * step + step / 2] = SIZE_MAX;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < m; i++) 
+        {
+            if (rest[i] != SIZE_MAX) 
+            {
+                rest[kept++] = rest[i];
+            }
+        }
+        m = kept;
+    }
+    for (size_t i = 0; i < m; i++) 
+    {
+        a[rest[i]].key = rand() % (next_key + 1);
+    }
+    for (size_t i = 0; i < n; i++) 
+    {
+        a[i].original_index = (int)i;
+    }
+
+    TIMER_START();
+    logsort(a, n, sizeof(Item), cmp_item);
+    double elapsed = TIMER_ELAPSED();
+    if (!is_sorted_and_stable(a, n)) 
+    {
+        fprintf(stderr, "ERROR: sample killer input – failed for n=%zu\n", n);
+        exit(1);
+    }
+    printf("sample killer n=%zu: %.3f s\n", n, elapsed);
+    free(a);
+    free(rest);
+}
+
 // Test: reverse case
 static void test_reversed(size_t n) 
 {
@@ -175,9 +270,446 @@ static void test_reversed(size_t n)
     free(a);
 }
 
-int main(void) 
+// Test: sorted prefix + unsorted appended tail
+static void test_append(size_t n, size_t m, int max_key) 
+{
+    Item *a = (Item *) calloc(n + m, sizeof(Item));
+    if (!a) { perror("malloc"); exit(1); }
+
+    fill_random(a, n + m, max_key);
+    logsort(a, n, sizeof(Item), cmp_item);
+    logsort_append(a, n, n + m, sizeof(Item), cmp_item);
+
+    if (!is_sorted_and_stable(a, n + m)) 
+    {
+        fprintf(stderr, "ERROR: append – failed for n=%zu, m=%zu\n", n, m);
+        exit(1);
+    }
+    free(a);
+}
+
+// Test: batches with growing keys, sorted prefix is read back before the end of input
+static void test_stream(size_t batches, size_t batch_size, int max_key) 
+{
+    LogsortStream stream;
+    if (logsort_stream_init(&stream, sizeof(Item), cmp_item) != 0) 
+    {
+        fprintf(stderr, "ERROR: stream init failed\n");
+        exit(1);
+    }
+
+    Item *batch = (Item *) calloc(batch_size, sizeof(Item));
+    Item *out = (Item *) calloc(batches * batch_size, sizeof(Item));
+    if (!batch || !out) { perror("malloc"); exit(1); }
+
+    size_t out_n = 0;
+    for (size_t b = 0; b < batches; b++) 
+    {
+        // keys of batch b are in [b * max_key / 2, b * max_key / 2 + max_key)
+        int low = (int)b * (max_key / 2);
+        for (size_t i = 0; i < batch_size; i++) 
+        {
+            batch[i].key = low + rand() % max_key;
+            batch[i].original_index = (int)(b * batch_size + i);
+        }
+        if (logsort_stream_push(&stream, batch, batch_size) != 0) 
+        {
+            fprintf(stderr, "ERROR: stream push failed\n");
+            exit(1);
+        }
+
+        Item watermark = {low + max_key / 2, 0};
+        const void *elem = NULL;
+        while ((elem = logsort_stream_next(&stream, &watermark)) != NULL) 
+        {
+            out[out_n++] = *(const Item *)elem;
+        }
+    }
+
+    const void *elem = NULL;
+    while ((elem = logsort_stream_next(&stream, NULL)) != NULL) 
+    {
+        out[out_n++] = *(const Item *)elem;
+    }
+
+    if (out_n != batches * batch_size || !is_sorted_and_stable(out, out_n)) 
+    {
+        fprintf(stderr, "ERROR: stream – failed for batches=%zu, batch_size=%zu\n", batches, batch_size);
+        exit(1);
+    }
+
+    logsort_stream_destroy(&stream);
+    free(batch);
+    free(out);
+}
+
+static int cmp_int(const void *pa, const void *pb) 
+{
+    int a = *(const int *)pa;
+    int b = *(const int *)pb;
+    if (a < b) return -1;
+    if (a > b) return +1;
+    return 0;
+}
+
+typedef struct 
+{
+    int key;
+    long long tag[3];
+} WideRow;
+
+// Test: key column + payload columns of different widths
+static void test_columns(size_t n, int max_key) 
+{
+    int *keys = (int *) calloc(n, sizeof(int));
+    int *index = (int *) calloc(n, sizeof(int));
+    char *bytes = (char *) calloc(n, 3);
+    WideRow *wide = (WideRow *) calloc(n, sizeof(WideRow));
+    Item *ref = (Item *) calloc(n, sizeof(Item));
+    if ((!keys || !index || !bytes || !wide || !ref) && n > 0) { perror("malloc"); exit(1); }
+
+    for (size_t i = 0; i < n; i++) 
+    {
+        keys[i] = rand() % max_key;
+        index[i] = (int)i;
+        memset(bytes + i * 3, (int)(i & 0x7f), 3);
+        wide[i].key = keys[i];
+        wide[i].tag[0] = wide[i].tag[1] = wide[i].tag[2] = (long long)i;
+        ref[i].key = keys[i];
+        ref[i].original_index = (int)i;
+    }
+
+    void *columns[] = {index, bytes, wide};
+    size_t column_sizes[] = {sizeof(int), 3, sizeof(WideRow)};
+    if (logsort_columns(keys, n, sizeof(int), cmp_int, columns, column_sizes, 3) != 0) 
+    {
+        fprintf(stderr, "ERROR: columns – sort failed for n=%zu\n", n);
+        exit(1);
+    }
+    logsort(ref, n, sizeof(Item), cmp_item);
+
+    for (size_t i = 0; i < n; i++) 
+    {
+        int idx = index[i];
+        if (keys[i] != ref[i].key || idx != ref[i].original_index || 
+            bytes[i * 3] != (char)(idx & 0x7f) || bytes[i * 3 + 2] != (char)(idx & 0x7f) || 
+            wide[i].key != keys[i] || wide[i].tag[2] != (long long)idx) 
+        {
+            fprintf(stderr, "ERROR: columns – mismatch at i=%zu for n=%zu\n", i, n);
+            exit(1);
+        }
+    }
+
+    free(keys);
+    free(index);
+    free(bytes);
+    free(wide);
+    free(ref);
+}
+
+// Test: library verifier finds broken order and broken stability
+static void test_verify(size_t n, int max_key) 
+{
+    Item *a = (Item *) calloc(n, sizeof(Item));
+    size_t *index = (size_t *) calloc(n, sizeof(size_t));
+    if (!a || !index) { perror("malloc"); exit(1); }
+
+    fill_random(a, n, max_key);
+    if (logsort_tagged(a, n, sizeof(Item), cmp_item, index) != 0) 
+    {
+        fprintf(stderr, "ERROR: verify – tagged sort failed for n=%zu\n", n);
+        exit(1);
+    }
+    for (size_t i = 0; i < n; i++) 
+    {
+        if ((size_t)a[i].original_index != index[i]) 
+        {
+            fprintf(stderr, "ERROR: verify – wrong hidden index at i=%zu for n=%zu\n", i, n);
+            exit(1);
+        }
+    }
+
+    LOGSORT_CHECK_SORTED(a, n, sizeof(Item), cmp_item);
+    if (logsort_sorted_until(a, n, sizeof(Item), cmp_item, 0) != n || 
+        logsort_sorted_until(a, n, sizeof(Item), cmp_item, 1) != n || 
+        logsort_stable_until(a, index, n, sizeof(Item), cmp_item, 4) != n || 
+        !logsort_sample_sorted(a, n, sizeof(Item), cmp_item, 100)) 
+    {
+        fprintf(stderr, "ERROR: verify – sorted array rejected for n=%zu\n", n);
+        exit(1);
+    }
+
+    if (n < 3) 
+    {
+        free(a);
+        free(index);
+        return;
+    }
+
+    // first pair of equal neighbours: swap the hidden indices
+    size_t eq = 1;
+    while (eq < n && a[eq - 1].key != a[eq].key) 
+    {
+        eq++;
+    }
+    if (eq < n) 
+    {
+        size_t tmp = index[eq - 1];
+        index[eq - 1] = index[eq];
+        index[eq] = tmp;
+        if (logsort_stable_until(a, index, n, sizeof(Item), cmp_item, 0) != eq) 
+        {
+            fprintf(stderr, "ERROR: verify – stability violation missed for n=%zu\n", n);
+            exit(1);
+        }
+    }
+
+    size_t bad = n - 1;
+    a[bad].key = -1;
+    if (logsort_sorted_until(a, n, sizeof(Item), cmp_item, 0) != bad || 
+        logsort_sample_sorted(a, n, sizeof(Item), cmp_item, 0)) 
+    {
+        fprintf(stderr, "ERROR: verify – unsorted array accepted for n=%zu\n", n);
+        exit(1);
+    }
+
+    free(a);
+    free(index);
+}
+
+// Test: logsort with every scratch allocation policy
+static void test_alloc_policy(const char *policy, size_t touch_threads, size_t n, int max_key) 
 {
-    srand((unsigned)time(NULL));
+    unsigned flags = LOGSORT_ALLOC_DEFAULT;
+    if (logsort_parse_alloc_policy(policy, &flags) != 0) 
+    {
+        fprintf(stderr, "ERROR: alloc – unknown policy %s\n", policy);
+        exit(1);
+    }
+
+    // mbind may be refused (seccomp without CAP_SYS_NICE, a kernel without NUMA): the allocation fails,
+    // and logsort() below must still sort through its default-policy retry
+    LogsortBuffer input;
+    int refused = logsort_buffer_alloc(&input, n * sizeof(Item), flags, touch_threads) != 0;
+    if (refused && (!(flags & LOGSORT_ALLOC_INTERLEAVE) || 
+                    logsort_buffer_alloc(&input, n * sizeof(Item), LOGSORT_ALLOC_DEFAULT, 1) != 0)) 
+    {
+        fprintf(stderr, "ERROR: alloc – %s allocation failed for n=%zu\n", policy, n);
+        exit(1);
+    }
+    int expect_mapped = n * sizeof(Item) >= LOGSORT_ALLOC_MIN_BYTES && (flags != LOGSORT_ALLOC_DEFAULT || touch_threads > 1);
+    if (!refused && (input.mapped != 0) != expect_mapped) 
+    {
+        fprintf(stderr, "ERROR: alloc – %s mapping threshold not applied for n=%zu\n", policy, n);
+        exit(1);
+    }
+    Item *a = (Item *)input.data;
+    for (size_t i = 0; i < n; i++) 
+    {
+        if (a[i].key != 0 || a[i].original_index != 0) 
+        {
+            fprintf(stderr, "ERROR: alloc – %s buffer is not zeroed\n", policy);
+            exit(1);
+        }
+    }
+    fill_random(a, n, max_key);
+
+    logsort_set_scratch_policy(flags, touch_threads);
+    logsort(a, n, sizeof(Item), cmp_item);
+    logsort_set_scratch_policy(LOGSORT_ALLOC_DEFAULT, 1);
+
+    if (!is_sorted_and_stable(a, n)) 
+    {
+        fprintf(stderr, "ERROR: alloc – %s failed for n=%zu\n", policy, n);
+        exit(1);
+    }
+    logsort_buffer_free(&input);
+}
+
+static void count_done(void *array, size_t size_of_array, void *user_data) 
+{
+    (void)array;
+    (void)size_of_array;
+    __atomic_fetch_add((size_t *)user_data, 1, __ATOMIC_RELAXED);
+}
+
+// Test: many small jobs + a huge split job through the executor
+static void test_executor(size_t workers, size_t jobs, size_t job_size, size_t huge_size, int max_key) 
+{
+    LogsortExecutor *executor = logsort_executor_create(workers);
+    Item *small = (Item *) calloc(jobs * job_size, sizeof(Item));
+    Item *huge = (Item *) calloc(huge_size, sizeof(Item));
+    LogsortJob **handles = (LogsortJob **) calloc(jobs, sizeof(LogsortJob *));
+    if (!executor || !small || !huge || !handles) { perror("malloc"); exit(1); }
+
+    for (size_t j = 0; j < jobs; j++) 
+    {
+        fill_random(small + j * job_size, job_size, max_key);
+    }
+    fill_random(huge, huge_size, max_key);
+
+    size_t done_cnt = 0;
+    LogsortJob *huge_job = logsort_executor_submit(executor, huge, huge_size, sizeof(Item), cmp_item, 
+                                                   count_done, &done_cnt);
+    for (size_t j = 0; j < jobs; j++) 
+    {
+        handles[j] = logsort_executor_submit(executor, small + j * job_size, job_size, sizeof(Item), cmp_item, 
+                                             count_done, &done_cnt);
+    }
+    for (size_t j = 0; j < jobs; j++) 
+    {
+        if (j % 2) 
+        {
+            logsort_job_wait(handles[j]);
+        } 
+        else 
+        {
+            logsort_job_release(handles[j]);
+        }
+    }
+    logsort_job_wait(huge_job);
+    logsort_executor_destroy(executor);
+
+    if (__atomic_load_n(&done_cnt, __ATOMIC_RELAXED) != jobs + 1) 
+    {
+        fprintf(stderr, "ERROR: executor – %zu of %zu callbacks\n", done_cnt, jobs + 1);
+        exit(1);
+    }
+    for (size_t j = 0; j < jobs; j++) 
+    {
+        if (!is_sorted_and_stable(small + j * job_size, job_size)) 
+        {
+            fprintf(stderr, "ERROR: executor – small job %zu failed\n", j);
+            exit(1);
+        }
+    }
+    if (!is_sorted_and_stable(huge, huge_size)) 
+    {
+        fprintf(stderr, "ERROR: executor – huge job failed for n=%zu\n", huge_size);
+        exit(1);
+    }
+
+    free(small);
+    free(huge);
+    free(handles);
+}
+
+// Test: Item header + payload for specialized (8/16/32) and generic element sizes
+static void test_element_size(size_t elem_size, size_t n, int max_key) 
+{
+    char *a = (char *) calloc(n, elem_size);
+    Item *ref = (Item *) calloc(n, sizeof(Item));
+    if (!a || !ref) { perror("malloc"); exit(1); }
+
+    fill_random(ref, n, max_key);
+    for (size_t i = 0; i < n; i++) 
+    {
+        memcpy(a + i * elem_size, &ref[i], sizeof(Item));
+        memset(a + i * elem_size + sizeof(Item), (int)(i & 0x7f), elem_size - sizeof(Item));
+    }
+    logsort(a, n, elem_size, cmp_item);
+    logsort(ref, n, sizeof(Item), cmp_item);
+
+    for (size_t i = 0; i < n; i++) 
+    {
+        Item item;
+        memcpy(&item, a + i * elem_size, sizeof(Item));
+        char tag = (char)(item.original_index & 0x7f);
+        if (item.key != ref[i].key || item.original_index != ref[i].original_index || 
+            (elem_size > sizeof(Item) && a[(i + 1) * elem_size - 1] != tag)) 
+        {
+            fprintf(stderr, "ERROR: element size %zu – mismatch at i=%zu for n=%zu\n", elem_size, i, n);
+            exit(1);
+        }
+    }
+
+    free(a);
+    free(ref);
+}
+
+typedef struct 
+{
+    int key;
+    int first_index; // original index of the element that survives the collapse
+    int count;
+    int sum;
+} GroupRow;
+
+static int cmp_group(const void *pa, const void *pb) 
+{
+    int a = ((const GroupRow *)pa)->key;
+    int b = ((const GroupRow *)pb)->key;
+    return (a > b) - (a < b);
+}
+
+static void combine_group(void *accumulator, const void *element) 
+{
+    GroupRow *acc = (GroupRow *)accumulator;
+    const GroupRow *row = (const GroupRow *)element;
+    acc->count += row->count;
+    acc->sum += row->sum;
+}
+
+// Test: logsort_unique / logsort_reduce against a stable sort followed by a linear dedupe / group-by
+static void test_unique(size_t n, int max_key) 
+{
+    GroupRow *a = (GroupRow *) calloc(n + 1, sizeof(GroupRow));
+    GroupRow *b = (GroupRow *) calloc(n + 1, sizeof(GroupRow));
+    GroupRow *ref = (GroupRow *) calloc(n + 1, sizeof(GroupRow));
+    if (!a || !b || !ref) { perror("malloc"); exit(1); }
+
+    for (size_t i = 0; i < n; i++) 
+    {
+        a[i].key = rand() % max_key;
+        a[i].first_index = (int)i;
+        a[i].count = 1;
+        a[i].sum = rand() % 100;
+    }
+    memcpy(b, a, n * sizeof(GroupRow));
+    memcpy(ref, a, n * sizeof(GroupRow));
+
+    logsort(ref, n, sizeof(GroupRow), cmp_group);
+    size_t groups = 0;
+    for (size_t i = 0; i < n; i++) 
+    {
+        if (groups > 0 && ref[groups - 1].key == ref[i].key) 
+        {
+            combine_group(&ref[groups - 1], &ref[i]);
+        } 
+        else 
+        {
+            ref[groups++] = ref[i];
+        }
+    }
+
+    size_t unique_n = logsort_unique(a, n, sizeof(GroupRow), cmp_group);
+    size_t reduce_n = logsort_reduce(b, n, sizeof(GroupRow), cmp_group, combine_group);
+    if (unique_n != groups || reduce_n != groups) 
+    {
+        fprintf(stderr, "ERROR: unique/reduce – %zu/%zu groups instead of %zu for n=%zu\n", unique_n, reduce_n, groups, n);
+        exit(1);
+    }
+    for (size_t i = 0; i < groups; i++) 
+    {
+        if (a[i].key != ref[i].key || a[i].first_index != ref[i].first_index || a[i].count != 1 || 
+            memcmp(&b[i], &ref[i], sizeof(GroupRow)) != 0) 
+        {
+            fprintf(stderr, "ERROR: unique/reduce – mismatch at i=%zu for n=%zu\n", i, n);
+            exit(1);
+        }
+    }
+
+    free(a);
+    free(b);
+    free(ref);
+}
+
+int main(int argc, char **argv) 
+{
+    // pass the printed seed back as argv[1] to reproduce a failing run
+    unsigned seed = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : (unsigned)time(NULL);
+    printf("seed = %u\n", seed);
+    srand(seed);
 
     printf("Testing Logsort...\n");
 
@@ -190,6 +722,7 @@ int main(void)
     test_random(10000, 1000);
     test_random(1000000, 1000);
     test_random(10000000, 1000);
+    test_random(2000000, 1 << 30);
     printf("Random tests passed\n");
 
     test_sorted(1000);
@@ -198,6 +731,64 @@ int main(void)
     test_reversed(1000);
     printf("Reversed-order test passed\n");
 
+    test_pivot_killers(1000000);
+    test_sample_killer(1 << 18);
+    test_sample_killer(1 << 19);
+    printf("Sawtooth / organ pipe tests passed\n");
+
+    test_append(0, 100, 10);
+    test_append(1000, 0, 10);
+    test_append(1000, 10, 50);
+    test_append(100000, 1000, 1000);
+    test_append(100000, 50000, 100);
+    printf("Append tests passed\n");
+
+    test_stream(1, 100, 10);
+    test_stream(50, 1000, 100);
+    test_stream(20, 5000, 10000);
+    printf("Stream tests passed\n");
+
+    test_columns(0, 10);
+    test_columns(20, 5);
+    test_columns(10000, 100);
+    test_columns(200000, 5000);
+    printf("Column tests passed\n");
+
+    test_verify(1, 10);
+    test_verify(1000, 50);
+    test_verify(1000000, 1000);
+    printf("Verifier tests passed\n");
+
+    test_alloc_policy("default", 1, 100000, 1000);
+    test_alloc_policy("default", 4, 100000, 1000);
+    test_alloc_policy("thp", 4, 1000, 100);
+    test_alloc_policy("thp", 1, 1000000, 1000);
+    test_alloc_policy("hugetlb", 2, 1000000, 1000);
+    test_alloc_policy("interleave+thp", 4, 1000000, 1000);
+    printf("Allocation policy tests passed\n");
+
+    test_executor(1, 100, 50, 1000, 20);
+    test_executor(4, 3000, 200, 2000000, 1000);
+    test_executor(0, 500, 5000, 3000000, 100000);
+    printf("Executor tests passed\n");
+
+    test_element_size(8, 100000, 1000);
+    test_element_size(12, 100000, 1000);
+    test_element_size(16, 300000, 1000);
+    test_element_size(32, 200000, 100000);
+    test_element_size(300, 20000, 100);
+    printf("Element size tests passed\n");
+
+    test_unique(0, 10);
+    test_unique(1, 10);
+    test_unique(30, 3);
+    test_unique(10000, 1);
+    test_unique(10000, 100);
+    test_unique(100000, 1 << 30);
+    test_unique(1000000, 50000);
+    test_unique(2000000, 1000);
+    printf("Unique / reduce tests passed\n");
+
     printf("All tests passed ✅\n");
     return 0;
 }